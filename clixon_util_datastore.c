@@ -42,15 +42,22 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <inttypes.h>
 #include <unistd.h>
 #include <stdarg.h>
+#include <ctype.h>
 #include <errno.h>
 #include <signal.h>
 #include <fcntl.h>
 #include <time.h>
 #include <signal.h>
 #include <syslog.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
 #include <sys/socket.h>
 #include <sys/param.h>
 #include <sys/types.h>
@@ -58,47 +65,4770 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/fs.h> /* FICLONE */
+#endif
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clicon */
+#include <clixon/clixon.h>
+
+/* Command line options to be passed to getopt(3) */
+#define DATASTORE_OPTS "hDd:b:f:x:y:Y:CJ:S:W:T:"
+
+/* Default journal size in bytes that triggers compaction into the db file */
+#define JOURNAL_COMPACT_SIZE (1024*1024)
+
+/* Default group commit window of wbench in usecs */
+#define GROUP_WINDOW_USEC 10000
+
+/*! usage
+ */
+static void
+usage(char *argv0)
+{
+    fprintf(stderr, "usage:%s <options>* [<command>]\n"
+            "where options are\n"
+            "\t-h\t\tHelp\n"
+            "\t-D\t\tDebug\n"
+            "\t-d <db>\t\tDatabase name. Default: running. Alt: candidate,startup\n"
+            "\t-b <dir>\tDatabase directory. Mandatory\n"
+            "\t-f <fmt>\tDatabase format: xml, json, journal or binary\n"
+            "\t-x <xml>\tXML file. Alternative to put <xml> argument\n"
+            "\t-y <file>\tYang file. Mandatory\n"
+            "\t-Y <dir> \tYang dirs (can be several)\n"
+            "\t-C \t\tCache get results, for mget and bench (xml or json format)\n"
+            "\t-J <bytes>\tJournal size that triggers compaction (default %d)\n"
+            "\t-S <level>\tPut durability: sync, group or async (default sync)\n"
+            "\t\t\tA single put has nothing to group with, group is sync and async is no fsync\n"
+            "\t-W <usec>\tGroup commit window of wbench (default %d)\n"
+            "\t-T <file>\tRecord get, put, copy and lock calls in trace file\n"
+            "and command is either:\n"
+            "\tget [-depth <n>] [-fields <fields>] [<xpath>]\n"
+            "\tmget <nr> [<xpath>]\n"
+            "\tput (merge|replace|create|delete|remove) [<xml>]\n"
+            "\tcopy <todb>\n"
+            "\tlock <pid>\n"
+            "\tunlock\n"
+            "\tunlock_all <pid>\n"
+            "\tislocked\n"
+            "\texists\n"
+            "\tdelete\n"
+            "\tinit\n"
+            "\tbench <nr> <get%%> <put%%> [<xpath>]  (put uses -x, remainder is copy, xml or json format)\n"
+            "\tcompact\t\t(journal format)\n"
+            "\tjbench <nr>\t(put uses -x, compare journal with full writes)\n"
+            "\texport <file> <fmt>\tWrite db to file, fmt is xml, json or binary\n"
+            "\timport <file> <fmt>\tReplace db with file contents\n"
+            "\tcoldload <file> <fmt> [<nr>]\tMeasure load time of file\n"
+            "\tsplit\t\tWrite db as one file per top-level module\n"
+            "\tlget [<xpath>]\tGet from split db, load only modules xpath may touch, rebuild if stale\n"
+            "\tstress <readers> <seconds>\tSnapshot readers with one writer (-x)\n"
+            "\thash\tContent hash and top-level subtree hashes of db\n"
+            "\tunchanged-since <hash>\tCheck if db content hash is still <hash>\n"
+            "\ttxn <file>\tApply edits, one \"<op> <xml>\" per line, write db once\n"
+            "\tcopybench <todb> <nr>\tCompare file clone copy with xmldb_copy\n"
+            "\twbench <nr>\t(put uses -x, throughput and loss window of -S level)\n"
+            "\tplbench <threads> <nr> [<usec>]\tBenchmark in-process partial subtree locks vs global lock,\n"
+            "\t\t\thold time usec. Not used by lock or put\n"
+            "\treplay <file> [<speed>]\tReplay trace, speed 0 is as fast as possible\n"
+            ,
+            argv0,
+            JOURNAL_COMPACT_SIZE,
+            GROUP_WINDOW_USEC
+            );
+    exit(0);
+}
+
+/*
+ * Operation trace (-T)
+ * Each get, put, copy and lock call is recorded in a binary trace file: a header
+ * followed by one record per call. The replay command re-executes a trace.
+ * Record payload is "<db>\0<arg>\0" where arg is the xpath of get, the XML of put,
+ * the target db of copy, and the id of lock and unlock_all. unlock_all is recorded
+ * with an empty db. A copy record also holds the copy primitive used, which replay
+ * uses as well, since a file clone and xmldb_copy differ widely in latency.
+ */
+#define TRACE_MAGIC   "CXTR"
+#define TRACE_VERSION 2
+
+#define FNV1A_OFFSET 0xcbf29ce484222325ULL
+#define FNV1A_PRIME  0x100000001b3ULL
+
+enum trace_op {
+    TRACE_GET = 0,
+    TRACE_PUT,
+    TRACE_COPY,
+    TRACE_LOCK,
+    TRACE_UNLOCK,
+    TRACE_UNLOCK_ALL,
+    TRACE_NR
+};
+
+static const char *trace_op_names[TRACE_NR] = {
+    "get", "put", "copy", "lock", "unlock", "unlock_all"
+};
+
+/*! Copy primitive of a copy record
+ */
+enum trace_copy_method {
+    TRACE_COPY_XMLDB = 0, /* xmldb_copy */
+    TRACE_COPY_CLONE      /* datastore_copy, clone of db file */
+};
+
+/*! Trace record, followed by tr_len bytes of payload
+ */
+struct trace_rec {
+    uint8_t  tr_op;    /* enum trace_op */
+    uint8_t  tr_edit;  /* enum operation_type of put, enum trace_copy_method of copy */
+    int8_t   tr_ret;   /* Return value of call */
+    uint8_t  tr_pad;
+    uint32_t tr_len;   /* Payload length */
+    uint64_t tr_time;  /* Start of call in usecs since start of trace */
+    uint64_t tr_usec;  /* Latency of call in usecs */
+    uint64_t tr_hash;  /* FNV-1a of payload */
+};
+
+/* Open trace file, or NULL if not tracing */
+static FILE *_trace_f = NULL;
+
+/* Start of trace */
+static struct timeval _trace_t0;
+
+static uint64_t
+fnv1a(uint64_t    hash,
+      const char *buf,
+      size_t      len)
+{
+    size_t i;
+
+    for (i=0; i<len; i++){
+        hash ^= (unsigned char)buf[i];
+        hash *= FNV1A_PRIME;
+    }
+    return hash;
+}
+
+/*! Open trace file and write header
+ */
+static int
+trace_open(char *filename)
+{
+    uint32_t version = TRACE_VERSION;
+
+    if ((_trace_f = fopen(filename, "w")) == NULL){
+        clixon_err(OE_UNIX, errno, "fopen(%s)", filename);
+        return -1;
+    }
+    if (fwrite(TRACE_MAGIC, 4, 1, _trace_f) != 1 ||
+        fwrite(&version, sizeof(version), 1, _trace_f) != 1){
+        clixon_err(OE_UNIX, errno, "fwrite(%s)", filename);
+        return -1;
+    }
+    gettimeofday(&_trace_t0, NULL);
+    return 0;
+}
+
+static int
+trace_close(void)
+{
+    int retval = 0;
+
+    if (_trace_f){
+        if (fclose(_trace_f) < 0){
+            clixon_err(OE_UNIX, errno, "fclose");
+            retval = -1;
+        }
+        _trace_f = NULL;
+    }
+    return retval;
+}
+
+/*! Write a trace record
+ *
+ * @param[in]  op    Traced call
+ * @param[in]  edit  Edit operation of put, copy method of copy
+ * @param[in]  ret   Return value of call
+ * @param[in]  t0    Start of call
+ * @param[in]  t1    End of call
+ * @param[in]  db    Database, first payload string
+ * @param[in]  arg   Second payload string
+ */
+static int
+trace_record(enum trace_op       op,
+             int                 edit,
+             int                 ret,
+             struct timeval     *t0,
+             struct timeval     *t1,
+             const char         *db,
+             const char         *arg)
+{
+    struct trace_rec tr = {0,};
+    struct timeval   td;
+    size_t           dblen = strlen(db) + 1;
+    size_t           arglen = strlen(arg) + 1;
+
+    tr.tr_op = op;
+    tr.tr_edit = edit;
+    tr.tr_ret = ret;
+    tr.tr_len = dblen + arglen;
+    timersub(t0, &_trace_t0, &td);
+    tr.tr_time = (uint64_t)td.tv_sec*1000000 + td.tv_usec;
+    timersub(t1, t0, &td);
+    tr.tr_usec = (uint64_t)td.tv_sec*1000000 + td.tv_usec;
+    tr.tr_hash = fnv1a(fnv1a(FNV1A_OFFSET, db, dblen), arg, arglen);
+    if (fwrite(&tr, sizeof(tr), 1, _trace_f) != 1 ||
+        fwrite(db, dblen, 1, _trace_f) != 1 ||
+        fwrite(arg, arglen, 1, _trace_f) != 1){
+        clixon_err(OE_UNIX, errno, "fwrite trace");
+        return -1;
+    }
+    return 0;
+}
+
+/*! xmldb_get, traced
+ */
+static int
+trace_get(clixon_handle h,
+          char         *db,
+          cvec         *nsc,
+          char         *xpath,
+          cxobj       **xtp)
+{
+    struct timeval t0;
+    struct timeval t1;
+    int            ret;
+
+    if (_trace_f == NULL)
+        return xmldb_get(h, db, nsc, xpath, xtp);
+    gettimeofday(&t0, NULL);
+    ret = xmldb_get(h, db, nsc, xpath, xtp);
+    gettimeofday(&t1, NULL);
+    if (trace_record(TRACE_GET, 0, ret, &t0, &t1, db, xpath?xpath:"/") < 0)
+        return -1;
+    return ret;
+}
+
+/*! xmldb_put, traced. The children of the put tree are recorded
+ */
+static int
+trace_put(clixon_handle       h,
+          char               *db,
+          enum operation_type op,
+          cxobj              *xt,
+          char               *username,
+          cbuf               *cbret)
+{
+    struct timeval t0;
+    struct timeval t1;
+    cbuf          *cb = NULL;
+    cxobj         *x;
+    int            ret = -1;
+
+    if (_trace_f == NULL)
+        return xmldb_put(h, db, op, xt, username, cbret);
+    if ((cb = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    x = NULL;
+    while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL)
+        if (clixon_xml2cbuf(cb, x, 0, 0, NULL, -1, 0) < 0)
+            goto done;
+    gettimeofday(&t0, NULL);
+    ret = xmldb_put(h, db, op, xt, username, cbret);
+    gettimeofday(&t1, NULL);
+    if (trace_record(TRACE_PUT, op, ret, &t0, &t1, db, cbuf_get(cb)) < 0)
+        ret = -1;
+ done:
+    if (cb)
+        cbuf_free(cb);
+    return ret;
+}
+
+/*! xmldb_copy, traced
+ */
+static int
+trace_copy(clixon_handle h,
+           char         *from,
+           char         *to)
+{
+    struct timeval t0;
+    struct timeval t1;
+    int            ret;
+
+    if (_trace_f == NULL)
+        return xmldb_copy(h, from, to);
+    gettimeofday(&t0, NULL);
+    ret = xmldb_copy(h, from, to);
+    gettimeofday(&t1, NULL);
+    if (trace_record(TRACE_COPY, TRACE_COPY_XMLDB, ret, &t0, &t1, from, to) < 0)
+        return -1;
+    return ret;
+}
+
+/*! xmldb_lock, traced
+ */
+static int
+trace_lock(clixon_handle h,
+           char         *db,
+           uint32_t      id)
+{
+    struct timeval t0;
+    struct timeval t1;
+    char           idstr[16];
+    int            ret;
+
+    if (_trace_f == NULL)
+        return xmldb_lock(h, db, id);
+    gettimeofday(&t0, NULL);
+    ret = xmldb_lock(h, db, id);
+    gettimeofday(&t1, NULL);
+    snprintf(idstr, sizeof(idstr), "%u", id);
+    if (trace_record(TRACE_LOCK, 0, ret, &t0, &t1, db, idstr) < 0)
+        return -1;
+    return ret;
+}
+
+/*! xmldb_unlock, traced
+ */
+static int
+trace_unlock(clixon_handle h,
+             char         *db)
+{
+    struct timeval t0;
+    struct timeval t1;
+    int            ret;
+
+    if (_trace_f == NULL)
+        return xmldb_unlock(h, db);
+    gettimeofday(&t0, NULL);
+    ret = xmldb_unlock(h, db);
+    gettimeofday(&t1, NULL);
+    if (trace_record(TRACE_UNLOCK, 0, ret, &t0, &t1, db, "") < 0)
+        return -1;
+    return ret;
+}
+
+/*! xmldb_unlock_all, traced
+ */
+static int
+trace_unlock_all(clixon_handle h,
+                 uint32_t      id)
+{
+    struct timeval t0;
+    struct timeval t1;
+    char           idstr[16];
+    int            ret;
+
+    if (_trace_f == NULL)
+        return xmldb_unlock_all(h, id);
+    gettimeofday(&t0, NULL);
+    ret = xmldb_unlock_all(h, id);
+    gettimeofday(&t1, NULL);
+    snprintf(idstr, sizeof(idstr), "%u", id);
+    if (trace_record(TRACE_UNLOCK_ALL, 0, ret, &t0, &t1, "", idstr) < 0)
+        return -1;
+    return ret;
+}
+
+#ifdef __APPLE__
+#define st_mtim st_mtimespec
+#endif
+
+/*! Identifies a version of a db file
+ *
+ * Changes on any write of the file, also by other processes
+ */
+struct ds_stamp {
+    struct timespec ds_mtime;
+    struct timespec ds_ctime; /* Also changes if mtime is set back, eg by touch -d */
+    off_t           ds_size;
+    ino_t           ds_ino;
+};
+
+/*! Cached result of an xpath-filtered get
+ */
+struct ds_cache_entry {
+    struct ds_cache_entry *de_next;
+    char                  *de_db;    /* Database name */
+    char                  *de_xpath; /* XPath of get */
+    char                  *de_top;   /* Top-level node name of xpath, or NULL if any */
+    struct ds_stamp        de_stamp; /* Version of db file the result is valid for */
+    cxobj                 *de_xt;    /* Result tree */
+};
+
+/*! Cache of xmldb_get results, keyed by db and xpath
+ *
+ * An entry is valid as long as the db file is unchanged. Writes made via this utility
+ * invalidate entries selectively: a put only invalidates entries whose xpath may
+ * select a top-level node of the put payload, the rest are re-stamped.
+ */
+struct ds_cache {
+    struct ds_cache_entry *dc_list;
+    int                    dc_hits;
+    int                    dc_misses;
+    int                    dc_invalidations;
+};
+
+/*! Check if a character may be part of an XML name (without colon)
+ */
+static int
+xpath_name_char(char c)
+{
+    return isalnum((unsigned char)c) || c == '-' || c == '_' || c == '.';
+}
+
+/*! Check if a character may start an XML name (without colon)
+ */
+static int
+xpath_name_start(char c)
+{
+    return isalpha((unsigned char)c) || c == '_';
+}
+
+/*! Check if a slash in a predicate starts a relative location step
+ *
+ * Relative only directly after a step name, ".", "]", "/" or a wildcard step.
+ * After whitespace, an operator or an operator name such as "and" or "div", the
+ * slash starts an absolute path.
+ * @param[in]  xpath  XPath
+ * @param[in]  s      Slash in a predicate of xpath
+ */
+static int
+xpath_pred_relative(char *xpath,
+                    char *s)
+{
+    char  *p;
+    size_t len;
+
+    if (s[-1] == ']' || s[-1] == '/')
+        return 1;
+    if (s[-1] == '*')
+        return s[-2] == '/' || s[-2] == '[' || s[-2] == ':';
+    for (p=s; p>xpath && (xpath_name_char(p[-1]) || p[-1] == ':'); p--);
+    len = s - p;
+    if (len == 1 && *p == '.')
+        return 1;
+    if (len == 0 || !xpath_name_start(*p))
+        return 0;
+    if (p[-1] == ' ' || p[-1] == '\t' || p[-1] == '\r' || p[-1] == '\n'){
+        if ((len == 3 && (strncmp(p, "and", 3) == 0 || strncmp(p, "div", 3) == 0 ||
+                          strncmp(p, "mod", 3) == 0)) ||
+            (len == 2 && strncmp(p, "or", 2) == 0))
+            return 0;
+    }
+    return 1;
+}
+
+/*! Check that an XPath only selects nodes under its first step
+ *
+ * Conservative: rejects unions, parent steps, function calls and absolute
+ * paths inside predicates, any of which may reach other top-level nodes.
+ * @param[in]  xpath   XPath
+ * @retval     1       Selects only under first step
+ * @retval     0       May depend on other top-level nodes
+ */
+static int
+xpath_top_confined(char *xpath)
+{
+    char *s;
+    char *p;
+    int   depth = 0;
+
+    if (strchr(xpath, '|') || strchr(xpath, '(') || strstr(xpath, "..") || strstr(xpath, "::"))
+        return 0;
+    for (s=xpath; *s; s++){
+        if (*s == '\'' || *s == '"'){ /* Skip literal */
+            if ((p = strchr(s+1, *s)) == NULL)
+                return 0;
+            s = p;
+        }
+        else if (*s == '[')
+            depth++;
+        else if (*s == ']')
+            depth--;
+        else if (*s == '/' && depth > 0 && !xpath_pred_relative(xpath, s))
+            return 0;
+    }
+    return depth == 0;
+}
+
+/*! Get prefix and local name of the first step of an absolute XPath
+ *
+ * Example: "/a:b[k='1']/c" gives prefix "a" and name "b". Gives name NULL if the
+ * top-level node cannot be determined exactly, eg "/", "//x", wildcards, unions, or if
+ * the xpath may depend on other top-level nodes, see xpath_top_confined.
+ * @param[in]  xpath   XPath
+ * @param[out] prefix  Malloced prefix or NULL, free with free (if not NULL)
+ * @param[out] name    Malloced top-level name or NULL if any, free with free
+ * @retval     0       OK
+ * @retval    -1       Error
+ */
+static int
+xpath_top_step(char  *xpath,
+               char **prefix,
+               char **name)
+{
+    char *s;
+    char *e;
+    char *c;
+    char *p;
+
+    if (prefix)
+        *prefix = NULL;
+    *name = NULL;
+    if (xpath == NULL || xpath[0] != '/' || xpath[1] == '/' || xpath[1] == '\0' ||
+        !xpath_top_confined(xpath))
+        return 0;
+    s = xpath + 1;
+    e = s + strcspn(s, "/[");
+    c = memchr(s, ':', e-s);
+    /* Prefix and name must be plain names ending the step */
+    for (p=s; p<e; p++)
+        if (p != c && !xpath_name_char(*p))
+            return 0;
+    if (s == e || !xpath_name_start(*s) || (c && !xpath_name_start(c[1])))
+        return 0;
+    if (c != NULL){
+        if (prefix && (*prefix = strndup(s, c-s)) == NULL)
+            goto err;
+        s = c + 1;
+    }
+    if ((*name = strndup(s, e-s)) == NULL)
+        goto err;
+    return 0;
+ err:
+    clixon_err(OE_UNIX, errno, "strndup");
+    return -1;
+}
+
+/*! Get current version stamp of a db file, zero if it does not exist
+ */
+static int
+ds_stamp_get(clixon_handle    h,
+             char            *db,
+             struct ds_stamp *stamp)
+{
+    int         retval = -1;
+    char       *filename = NULL;
+    struct stat st;
+
+    memset(stamp, 0, sizeof(*stamp));
+    if (xmldb_db2file(h, db, &filename) < 0)
+        goto done;
+    if (stat(filename, &st) == 0){
+        stamp->ds_mtime = st.st_mtim;
+        stamp->ds_ctime = st.st_ctim;
+        stamp->ds_size = st.st_size;
+        stamp->ds_ino = st.st_ino;
+    }
+    retval = 0;
+ done:
+    if (filename)
+        free(filename);
+    return retval;
+}
+
+static int
+ds_stamp_eq(struct ds_stamp *s0,
+            struct ds_stamp *s1)
+{
+    return s0->ds_mtime.tv_sec == s1->ds_mtime.tv_sec &&
+        s0->ds_mtime.tv_nsec == s1->ds_mtime.tv_nsec &&
+        s0->ds_ctime.tv_sec == s1->ds_ctime.tv_sec &&
+        s0->ds_ctime.tv_nsec == s1->ds_ctime.tv_nsec &&
+        s0->ds_size == s1->ds_size &&
+        s0->ds_ino == s1->ds_ino;
+}
+
+static void
+ds_cache_entry_free(struct ds_cache_entry *de)
+{
+    if (de->de_db)
+        free(de->de_db);
+    if (de->de_xpath)
+        free(de->de_xpath);
+    if (de->de_top)
+        free(de->de_top);
+    if (de->de_xt)
+        xml_free(de->de_xt);
+    free(de);
+}
+
+/*! Get from datastore via cache
+ *
+ * @param[in]  dc     Cache
+ * @param[in]  h      Clixon handle
+ * @param[in]  db     Database name
+ * @param[in]  xpath  XPath
+ * @param[out] xtp    Result tree, owned by cache, do not free
+ */
+static int
+ds_cache_get(struct ds_cache *dc,
+             clixon_handle    h,
+             char            *db,
+             char            *xpath,
+             cxobj          **xtp)
+{
+    int                    retval = -1;
+    struct ds_cache_entry *de;
+    struct ds_stamp        stamp;
+
+    if (ds_stamp_get(h, db, &stamp) < 0)
+        goto done;
+    for (de = dc->dc_list; de; de = de->de_next)
+        if (strcmp(de->de_db, db) == 0 && strcmp(de->de_xpath, xpath) == 0)
+            break;
+    if (de && de->de_xt && ds_stamp_eq(&de->de_stamp, &stamp)){
+        dc->dc_hits++;
+        *xtp = de->de_xt;
+        goto ok;
+    }
+    dc->dc_misses++;
+    if (de == NULL){
+        if ((de = calloc(1, sizeof(*de))) == NULL){
+            clixon_err(OE_UNIX, errno, "calloc");
+            goto done;
+        }
+        if ((de->de_db = strdup(db)) == NULL ||
+            (de->de_xpath = strdup(xpath)) == NULL){
+            clixon_err(OE_UNIX, errno, "strdup");
+            ds_cache_entry_free(de);
+            goto done;
+        }
+        if (xpath_top_step(xpath, NULL, &de->de_top) < 0){
+            ds_cache_entry_free(de);
+            goto done;
+        }
+        de->de_next = dc->dc_list;
+        dc->dc_list = de;
+    }
+    else if (de->de_xt){
+        dc->dc_invalidations++;
+        xml_free(de->de_xt);
+        de->de_xt = NULL;
+    }
+    if (trace_get(h, db, NULL, xpath, &de->de_xt) < 0)
+        goto done;
+    de->de_stamp = stamp;
+    *xtp = de->de_xt;
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Invalidate cache entries of a db after a write via this utility
+ *
+ * @param[in]  dc    Cache
+ * @param[in]  h     Clixon handle
+ * @param[in]  db    Database name that has been written
+ * @param[in]  xput  Put payload, or NULL if the whole db may have changed
+ */
+static int
+ds_cache_invalidate(struct ds_cache *dc,
+                    clixon_handle    h,
+                    char            *db,
+                    cxobj           *xput)
+{
+    int                     retval = -1;
+    struct ds_cache_entry **dep;
+    struct ds_cache_entry  *de;
+    struct ds_stamp         stamp;
+
+    if (ds_stamp_get(h, db, &stamp) < 0)
+        goto done;
+    dep = &dc->dc_list;
+    while ((de = *dep) != NULL){
+        if (strcmp(de->de_db, db) != 0){
+            dep = &de->de_next;
+            continue;
+        }
+        if (xput != NULL && de->de_top != NULL &&
+            xml_find_type(xput, NULL, de->de_top, CX_ELMNT) == NULL){
+            de->de_stamp = stamp; /* Subtree not touched by write */
+            dep = &de->de_next;
+            continue;
+        }
+        dc->dc_invalidations++;
+        *dep = de->de_next;
+        ds_cache_entry_free(de);
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+
+static void
+ds_cache_free(struct ds_cache *dc)
+{
+    struct ds_cache_entry *de;
+
+    while ((de = dc->dc_list) != NULL){
+        dc->dc_list = de->de_next;
+        ds_cache_entry_free(de);
+    }
+}
+
+static void
+ds_cache_print(FILE            *f,
+               struct ds_cache *dc)
+{
+    fprintf(f, "cache: hits: %d misses: %d invalidations: %d\n",
+            dc->dc_hits, dc->dc_misses, dc->dc_invalidations);
+}
+
+/* Name of scratch db used as copy target in bench */
+#define BENCH_COPY_DB "bench"
+
+/*! Latency samples of one operation type in a benchmark
+ */
+struct bench_stat {
+    char     *bs_name; /* Operation name */
+    uint64_t *bs_vec;  /* Latency samples in usecs */
+    int       bs_len;  /* Number of samples */
+};
+
+static uint64_t
+timeval2usec(struct timeval *t)
+{
+    return (uint64_t)t->tv_sec*1000000 + t->tv_usec;
+}
+
+static int
+uint64_cmp(const void *a,
+           const void *b)
+{
+    uint64_t ia = *(uint64_t*)a;
+    uint64_t ib = *(uint64_t*)b;
+
+    return ia < ib ? -1 : ia > ib;
+}
+
+/*! Add a latency sample
+ */
+static int
+bench_stat_add(struct bench_stat *bs,
+               uint64_t           usec)
+{
+    if ((bs->bs_len % 1024) == 0 &&
+        (bs->bs_vec = realloc(bs->bs_vec, (bs->bs_len+1024)*sizeof(uint64_t))) == NULL){
+        clixon_err(OE_UNIX, errno, "realloc");
+        return -1;
+    }
+    bs->bs_vec[bs->bs_len++] = usec;
+    return 0;
+}
+
+/*! Get percentile from sorted latency vector
+ *
+ * @param[in]  vec  Sorted vector of samples
+ * @param[in]  len  Length of vector
+ * @param[in]  p    Percentile as fraction, eg 0.99
+ */
+static uint64_t
+bench_percentile(uint64_t *vec,
+                 int       len,
+                 double    p)
+{
+    int i;
+
+    if (len == 0)
+        return 0;
+    i = (int)(p*len);
+    if (i >= len)
+        i = len-1;
+    return vec[i];
+}
+
+/*! Sort samples and print nr of ops, p50, p99, p999 and max latency
+ */
+static void
+bench_stat_print(FILE              *f,
+                 struct bench_stat *bs)
+{
+    if (bs->bs_len == 0)
+        return;
+    qsort(bs->bs_vec, bs->bs_len, sizeof(uint64_t), uint64_cmp);
+    fprintf(f, "%-6s ops: %-8d p50: %-8" PRIu64 " p99: %-8" PRIu64 " p999: %-8" PRIu64 " max: %" PRIu64 " usec\n",
+            bs->bs_name, bs->bs_len,
+            bench_percentile(bs->bs_vec, bs->bs_len, 0.5),
+            bench_percentile(bs->bs_vec, bs->bs_len, 0.99),
+            bench_percentile(bs->bs_vec, bs->bs_len, 0.999),
+            bs->bs_vec[bs->bs_len-1]);
+}
+
+/*! Parse XML file as put payload, with top-level renamed to config
+ *
+ * @param[in]  filename  XML file
+ * @param[in]  yspec     YANG spec
+ * @param[out] xtp       XML tree, free with xml_free
+ */
+static int
+datastore_xml_file(char      *filename,
+                   yang_stmt *yspec,
+                   cxobj    **xtp)
+{
+    int    retval = -1;
+    FILE  *fp = NULL;
+    cxobj *xerr = NULL;
+    int    ret;
+
+    if ((fp = fopen(filename, "r")) == NULL){
+        clixon_err(OE_UNIX, errno, "fopen(%s)", filename);
+        goto done;
+    }
+    if ((ret = clixon_xml_parse_file(fp, YB_MODULE, yspec, xtp, &xerr)) < 0)
+        goto done;
+    if (ret == 0){
+        xml_print(stderr, xerr);
+        clixon_err(OE_XML, 0, "Parsing %s", filename);
+        goto done;
+    }
+    if (xml_name_set(*xtp, NETCONF_INPUT_CONFIG) < 0)
+        goto done;
+    retval = 0;
+ done:
+    if (xerr)
+        xml_free(xerr);
+    if (fp)
+        fclose(fp);
+    return retval;
+}
+
+/*! Run a mixed get/put/copy workload and print throughput, latency and memory growth
+ *
+ * Operations are drawn from a fixed-seed random sequence so that runs are repeatable.
+ * Get results are not printed. Put is a merge of the XML in xmlfilename, copy is from
+ * db to a scratch db which is removed afterwards.
+ * @param[in]  h           Clixon handle
+ * @param[in]  db          Database name
+ * @param[in]  yspec       YANG spec
+ * @param[in]  xmlfilename XML payload of put, needed if putpct > 0
+ * @param[in]  nr          Number of operations
+ * @param[in]  getpct      Percentage of get operations
+ * @param[in]  putpct      Percentage of put operations, the rest are copy
+ * @param[in]  xpath       XPath of get
+ * @param[in]  dc          Cache of get results, or NULL
+ */
+static int
+datastore_bench(clixon_handle h,
+                char         *db,
+                yang_stmt    *yspec,
+                char         *xmlfilename,
+                int           nr,
+                int           getpct,
+                int           putpct,
+                char         *xpath,
+                struct ds_cache *dc)
+{
+    int               retval = -1;
+    cxobj            *xput = NULL;
+    cxobj            *x1 = NULL;
+    cxobj            *xt = NULL;
+    cxobj            *xc = NULL;
+    cbuf             *cbret = NULL;
+    struct bench_stat bs[] = {{"get",}, {"put",}, {"copy",}, {"all",}};
+    struct timeval    t0;
+    struct timeval    t1;
+    struct timeval    td;
+    struct timeval    tstart;
+    struct rusage     ru0;
+    struct rusage     ru1;
+    uint64_t          usec;
+    int               op;
+    int               r;
+    int               i;
+
+    if (getpct < 0 || putpct < 0 || getpct + putpct > 100){
+        clixon_err(OE_DB, 0, "Invalid get/put percentages: %d %d", getpct, putpct);
+        goto done;
+    }
+    if (putpct > 0){
+        if (xmlfilename == NULL){
+            clixon_err(OE_DB, 0, "put requires -x <xml>");
+            goto done;
+        }
+        if (datastore_xml_file(xmlfilename, yspec, &xput) < 0)
+            goto done;
+    }
+    if ((cbret = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    srandom(1);
+    getrusage(RUSAGE_SELF, &ru0);
+    gettimeofday(&tstart, NULL);
+    for (i=0; i<nr; i++){
+        r = random() % 100;
+        op = r < getpct ? 0 : r < getpct + putpct ? 1 : 2;
+        if (op == 1 && (x1 = xml_dup(xput)) == NULL)
+            goto done;
+        gettimeofday(&t0, NULL);
+        switch (op){
+        case 0:
+            if (dc){
+                if (ds_cache_get(dc, h, db, xpath, &xc) < 0)
+                    goto done;
+            }
+            else if (trace_get(h, db, NULL, xpath, &xt) < 0)
+                goto done;
+            break;
+        case 1:
+            cbuf_reset(cbret);
+            if (trace_put(h, db, OP_MERGE, x1, NULL, cbret) < 0)
+                goto done;
+            if (dc && ds_cache_invalidate(dc, h, db, xput) < 0)
+                goto done;
+            break;
+        case 2:
+            if (trace_copy(h, db, BENCH_COPY_DB) < 0)
+                goto done;
+            if (dc && ds_cache_invalidate(dc, h, BENCH_COPY_DB, NULL) < 0)
+                goto done;
+            break;
+        }
+        gettimeofday(&t1, NULL);
+        timersub(&t1, &t0, &td);
+        usec = timeval2usec(&td);
+        if (bench_stat_add(&bs[op], usec) < 0)
+            goto done;
+        if (bench_stat_add(&bs[3], usec) < 0)
+            goto done;
+        if (xt){
+            xml_free(xt);
+            xt = NULL;
+        }
+        if (x1){
+            xml_free(x1);
+            x1 = NULL;
+        }
+    }
+    gettimeofday(&t1, NULL);
+    getrusage(RUSAGE_SELF, &ru1);
+    timersub(&t1, &tstart, &td);
+    usec = timeval2usec(&td);
+    fprintf(stdout, "db: %s format: %s ops: %d time: %lu.%06lu s ops/s: %.1f\n",
+            db, clicon_option_str(h, "CLICON_XMLDB_FORMAT"), nr,
+            td.tv_sec, td.tv_usec, usec ? (double)nr*1000000/usec : 0.0);
+    for (i=0; i<4; i++)
+        bench_stat_print(stdout, &bs[i]);
+    fprintf(stdout, "maxrss: start: %ld KB end: %ld KB growth: %ld KB\n",
+            ru0.ru_maxrss, ru1.ru_maxrss, ru1.ru_maxrss - ru0.ru_maxrss);
+    if (dc)
+        ds_cache_print(stdout, dc);
+    if (bs[2].bs_len && xmldb_delete(h, BENCH_COPY_DB) < 0)
+        goto done;
+    retval = 0;
+ done:
+    for (i=0; i<4; i++)
+        if (bs[i].bs_vec)
+            free(bs[i].bs_vec);
+    if (cbret)
+        cbuf_free(cbret);
+    if (xt)
+        xml_free(xt);
+    if (x1)
+        xml_free(x1);
+    if (xput)
+        xml_free(xput);
+    return retval;
+}
+
+/*
+ * Journaled datastore format (-f journal)
+ * The db file is an XML snapshot. Each put appends the edit operation and its payload
+ * to a journal file "<dbfile>.journal" instead of rewriting the db file. A get loads
+ * the snapshot and replays the journal. The journal is compacted into a new snapshot
+ * when it grows past a size threshold, or by the compact command.
+ * A journal record is: "<operation> <len>\n<xml of len bytes>\n"
+ */
+
+/*! Get name of a file stored alongside the db file, ie "<dbfile><suffix>"
+ *
+ * @param[in]  h         Clixon handle
+ * @param[in]  db        Database name
+ * @param[in]  suffix    File suffix, eg ".journal"
+ * @param[out] filename  Malloced filename, free with free
+ */
+static int
+db_sidefile(clixon_handle h,
+            char         *db,
+            const char   *suffix,
+            char        **filename)
+{
+    int   retval = -1;
+    char *dbfile = NULL;
+    cbuf *cb = NULL;
+
+    if (xmldb_db2file(h, db, &dbfile) < 0)
+        goto done;
+    if ((cb = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    cprintf(cb, "%s%s", dbfile, suffix);
+    if ((*filename = strdup(cbuf_get(cb))) == NULL){
+        clixon_err(OE_UNIX, errno, "strdup");
+        goto done;
+    }
+    retval = 0;
+ done:
+    if (cb)
+        cbuf_free(cb);
+    if (dbfile)
+        free(dbfile);
+    return retval;
+}
+
+/*! Get name of journal file of a db
+ */
+static int
+journal_file(clixon_handle h,
+             char         *db,
+             char        **filename)
+{
+    return db_sidefile(h, db, ".journal", filename);
+}
+
+/*! Check if all element children of a list entry are keys, ie it identifies the entry only
+ */
+static int
+datastore_keyonly(cxobj *x)
+{
+    yang_stmt *y;
+    cxobj     *xc;
+    cg_var    *cvi;
+
+    if ((y = xml_spec(x)) == NULL || yang_keyword_get(y) != Y_LIST)
+        return xml_child_nr_type(x, CX_ELMNT) == 0;
+    xc = NULL;
+    while ((xc = xml_child_each(x, xc, CX_ELMNT)) != NULL){
+        cvi = NULL;
+        while ((cvi = cvec_each(yang_cvec_get(y), cvi)) != NULL)
+            if (strcmp(xml_name(xc), cv_string_get(cvi)) == 0)
+                break;
+        if (cvi == NULL)
+            return 0;
+    }
+    return 1;
+}
+
+/*! Remove nodes identified by the leaf-most nodes of x1 from x0
+ *
+ * Nodes that do not exist in x0 are ignored, ie delete is treated as remove
+ * @param[in]  x0  Base tree
+ * @param[in]  x1  Tree whose leaf-most nodes (or key-only list entries) identify nodes to remove
+ */
+static int
+datastore_remove(cxobj *x0,
+               cxobj *x1)
+{
+    int    retval = -1;
+    cxobj *x1c;
+    cxobj *x0c;
+
+    x1c = NULL;
+    while ((x1c = xml_child_each(x1, x1c, CX_ELMNT)) != NULL){
+        x0c = NULL;
+        if (match_base_child(x0, x1c, xml_spec(x1c), &x0c) < 0)
+            goto done;
+        if (x0c == NULL)
+            continue;
+        if (datastore_keyonly(x1c)){
+            if (xml_purge(x0c) < 0)
+                goto done;
+        }
+        else if (datastore_remove(x0c, x1c) < 0)
+            goto done;
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Reject nc:operation attributes in an edit payload
+ *
+ * datastore_apply only implements the operation of the whole edit
+ * @param[in]  x1  Edit payload
+ */
+static int
+datastore_check_nested(cxobj *x1)
+{
+    cxobj *xc;
+    char  *ns;
+
+    xc = NULL;
+    while ((xc = xml_child_each(x1, xc, -1)) != NULL){
+        if (xml_type(xc) == CX_ATTR){
+            if (strcmp(xml_name(xc), "operation") != 0)
+                continue;
+            ns = NULL;
+            if (xml2ns(x1, xml_prefix(xc), &ns) < 0)
+                return -1;
+            if (ns && strcmp(ns, NETCONF_BASE_NAMESPACE) == 0){
+                clixon_err(OE_DB, 0, "Nested operation on %s not supported", xml_name(x1));
+                return -1;
+            }
+        }
+        else if (xml_type(xc) == CX_ELMNT && datastore_check_nested(xc) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/*! Check existence of the leaf-most nodes of an edit payload as create and delete require
+ *
+ * @param[in]  x0  Base tree
+ * @param[in]  x1  Edit payload
+ * @param[in]  op  OP_CREATE: nodes must not exist, OP_DELETE: nodes must exist
+ */
+static int
+datastore_check_exist(cxobj              *x0,
+                      cxobj              *x1,
+                      enum operation_type op)
+{
+    cxobj *x1c;
+    cxobj *x0c;
+
+    x1c = NULL;
+    while ((x1c = xml_child_each(x1, x1c, CX_ELMNT)) != NULL){
+        x0c = NULL;
+        if (x0 && match_base_child(x0, x1c, xml_spec(x1c), &x0c) < 0)
+            return -1;
+        if (datastore_keyonly(x1c)){
+            if (op == OP_CREATE && x0c != NULL){
+                clixon_err(OE_DB, 0, "Data already exists: %s", xml_name(x1c));
+                return -1;
+            }
+            if (op == OP_DELETE && x0c == NULL){
+                clixon_err(OE_DB, 0, "Data missing: %s", xml_name(x1c));
+                return -1;
+            }
+        }
+        else if (datastore_check_exist(x0c, x1c, op) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/*! Apply one edit operation to an in-memory datastore tree
+ *
+ * Follows xmldb_put for an operation on the whole edit: create fails if data exists
+ * and delete if it does not. Nested nc:operation attributes are not supported and
+ * are rejected before anything is applied.
+ * Without check, the edit is assumed to be already checked, eg when a journal is
+ * replayed, and create is applied as merge and delete as remove.
+ * @param[in]  xt     Datastore tree
+ * @param[in]  op     Edit operation
+ * @param[in]  x1     Edit payload
+ * @param[in]  yspec  YANG spec
+ * @param[in]  check  Check nested operations and existence before applying
+ */
+static int
+datastore_apply(cxobj              *xt,
+              enum operation_type op,
+              cxobj              *x1,
+              yang_stmt          *yspec,
+              int                 check)
+{
+    int    retval = -1;
+    char  *reason = NULL;
+    cxobj *xc;
+    int    ret;
+
+    if (check && datastore_check_nested(x1) < 0)
+        goto done;
+    if (check && (op == OP_CREATE || op == OP_DELETE) &&
+        datastore_check_exist(xt, x1, op) < 0)
+        goto done;
+    switch (op){
+    case OP_REPLACE:
+        while ((xc = xml_child_i_type(xt, 0, CX_ELMNT)) != NULL)
+            if (xml_purge(xc) < 0)
+                goto done;
+        /* fall through */
+    case OP_MERGE:
+    case OP_CREATE:
+        if ((ret = xml_merge(xt, x1, yspec, &reason)) < 0)
+            goto done;
+        if (ret == 0){
+            clixon_err(OE_DB, 0, "%s", reason);
+            goto done;
+        }
+        break;
+    case OP_DELETE:
+    case OP_REMOVE:
+        if (datastore_remove(xt, x1) < 0)
+            goto done;
+        break;
+    default:
+        clixon_err(OE_DB, 0, "Unsupported operation: %s", xml_operation2str(op));
+        goto done;
+    }
+    retval = 0;
+ done:
+    if (reason)
+        free(reason);
+    return retval;
+}
+
+/*! Read the next record of a journal
+ *
+ * A record is a header line "<operation> <length>", length bytes of XML payload and
+ * a newline. A record cut short by a crash during append, in its header or in its
+ * payload, is torn and ends the journal just as end-of-file.
+ * @param[in]  fp        Journal file, positioned at start of a record
+ * @param[in]  filename  Journal filename, for errors
+ * @param[in]  nr        Record number, for errors
+ * @param[out] opp       Edit operation
+ * @param[out] bufp      Malloced payload, free with free. If NULL, the payload is skipped
+ * @retval     1         OK, record read
+ * @retval     0         End of journal, or torn record
+ * @retval    -1         Error, eg malformed header
+ */
+static int
+journal_record(FILE                *fp,
+               char                *filename,
+               int                  nr,
+               enum operation_type *opp,
+               char               **bufp)
+{
+    int     retval = -1;
+    char   *line = NULL;
+    size_t  linelen = 0;
+    ssize_t n;
+    char    opstr[32];
+    size_t  len;
+    char   *buf = NULL;
+
+    if ((n = getline(&line, &linelen, fp)) <= 0 ||
+        line[n-1] != '\n') /* End or torn header */
+        goto end;
+    if (sscanf(line, "%31s %zu", opstr, &len) != 2 ||
+        xml_operation(opstr, opp) < 0){
+        clixon_err(OE_DB, 0, "%s: bad journal record %d", filename, nr);
+        goto done;
+    }
+    if (bufp == NULL){
+        if (fseeko(fp, len, SEEK_CUR) < 0 || fgetc(fp) != '\n')
+            goto end;
+    }
+    else {
+        if ((buf = malloc(len+1)) == NULL){
+            clixon_err(OE_UNIX, errno, "malloc");
+            goto done;
+        }
+        if (fread(buf, 1, len, fp) != len || fgetc(fp) != '\n')
+            goto end;
+        buf[len] = '\0';
+        *bufp = buf;
+        buf = NULL;
+    }
+    retval = 1;
+ done:
+    if (buf)
+        free(buf);
+    if (line)
+        free(line);
+    return retval;
+ end:
+    retval = 0;
+    goto done;
+}
+
+/*! Append an edit record to the journal of a db and sync it to disk
+ *
+ * A torn record at the end of the journal, left by a crash during an earlier append,
+ * is first truncated away, so that the new record is not appended after garbage.
+ *
+ * @param[in]  h     Clixon handle
+ * @param[in]  db    Database name
+ * @param[in]  op    Edit operation
+ * @param[in]  x1    Edit payload
+ * @param[out] lenp  Number of bytes appended (if not NULL)
+ */
+static int
+journal_append(clixon_handle       h,
+               char               *db,
+               enum operation_type op,
+               cxobj              *x1,
+               size_t             *lenp)
+{
+    int                 retval = -1;
+    char               *filename = NULL;
+    FILE               *fp = NULL;
+    cbuf               *cb = NULL;
+    int                 fd;
+    struct stat         st;
+    enum operation_type op1;
+    off_t               good = 0;
+    int                 nr = 0;
+    int                 len;
+    int                 ret;
+
+    if (journal_file(h, db, &filename) < 0)
+        goto done;
+    if ((cb = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    if (clixon_xml2cbuf(cb, x1, 0, 0, NULL, -1, 1) < 0)
+        goto done;
+    if ((fd = open(filename, O_RDWR|O_CREAT|O_APPEND, 0666)) < 0){
+        clixon_err(OE_UNIX, errno, "open(%s)", filename);
+        goto done;
+    }
+    if ((fp = fdopen(fd, "a+")) == NULL){
+        clixon_err(OE_UNIX, errno, "fdopen(%s)", filename);
+        close(fd);
+        goto done;
+    }
+    /* Find end of last complete record */
+    while ((ret = journal_record(fp, filename, nr, &op1, NULL)) == 1){
+        good = ftello(fp);
+        nr++;
+    }
+    if (ret < 0)
+        goto done;
+    if (fstat(fd, &st) < 0){
+        clixon_err(OE_UNIX, errno, "fstat(%s)", filename);
+        goto done;
+    }
+    if (st.st_size > good){
+        clixon_log(h, LOG_WARNING, "%s: torn journal record %d truncated", filename, nr);
+        if (ftruncate(fd, good) < 0){
+            clixon_err(OE_UNIX, errno, "ftruncate(%s)", filename);
+            goto done;
+        }
+    }
+    if (fseeko(fp, 0, SEEK_END) < 0){
+        clixon_err(OE_UNIX, errno, "fseeko(%s)", filename);
+        goto done;
+    }
+    if ((len = fprintf(fp, "%s %zu\n%s\n", xml_operation2str(op), cbuf_len(cb), cbuf_get(cb))) < 0 ||
+        fflush(fp) != 0 ||
+        fsync(fileno(fp)) < 0){
+        clixon_err(OE_UNIX, errno, "write(%s)", filename);
+        goto done;
+    }
+    if (lenp)
+        *lenp = len;
+    retval = 0;
+ done:
+    if (fp)
+        fclose(fp);
+    if (cb)
+        cbuf_free(cb);
+    if (filename)
+        free(filename);
+    return retval;
+}
+
+/*! Load a journaled db: read the snapshot and replay the journal
+ *
+ * @param[in]  h      Clixon handle
+ * @param[in]  db     Database name
+ * @param[in]  yspec  YANG spec
+ * @param[out] xtp    Datastore tree, free with xml_free
+ * @param[out] nrp    Number of journal records replayed (if not NULL)
+ */
+static int
+journal_load(clixon_handle h,
+             char         *db,
+             yang_stmt    *yspec,
+             cxobj       **xtp,
+             int          *nrp)
+{
+    int                 retval = -1;
+    char               *filename = NULL;
+    FILE               *fp = NULL;
+    char               *buf = NULL;
+    cxobj              *xt = NULL;
+    cxobj              *x1 = NULL;
+    cxobj              *xerr = NULL;
+    enum operation_type op;
+    struct stat         st;
+    off_t               good = 0;
+    int                 nr = 0;
+    int                 ret;
+
+    if (trace_get(h, db, NULL, "/", &xt) < 0)
+        goto done;
+    if (journal_file(h, db, &filename) < 0)
+        goto done;
+    if ((fp = fopen(filename, "r")) == NULL){
+        if (errno != ENOENT){
+            clixon_err(OE_UNIX, errno, "fopen(%s)", filename);
+            goto done;
+        }
+    }
+    while (fp && (ret = journal_record(fp, filename, nr, &op, &buf)) != 0){
+        if (ret < 0)
+            goto done;
+        if ((ret = clixon_xml_parse_string(buf, YB_MODULE, yspec, &x1, &xerr)) < 0)
+            goto done;
+        if (ret == 0){
+            clixon_err_netconf(h, OE_XML, 0, xerr, "%s: journal record %d", filename, nr);
+            goto done;
+        }
+        if (datastore_apply(xt, op, x1, yspec, 0) < 0)
+            goto done;
+        xml_free(x1);
+        x1 = NULL;
+        free(buf);
+        buf = NULL;
+        good = ftello(fp);
+        nr++;
+    }
+    /* A torn last record, eg crash during append, is ignored here and truncated by
+     * the next append */
+    if (fp && fstat(fileno(fp), &st) == 0 && st.st_size > good)
+        clixon_log(h, LOG_WARNING, "%s: torn journal record %d ignored", filename, nr);
+    if (nr && xml_sort_recurse(xt) < 0)
+        goto done;
+    *xtp = xt;
+    xt = NULL;
+    if (nrp)
+        *nrp = nr;
+    retval = 0;
+ done:
+    if (xerr)
+        xml_free(xerr);
+    if (x1)
+        xml_free(x1);
+    if (xt)
+        xml_free(xt);
+    if (buf)
+        free(buf);
+    if (fp)
+        fclose(fp);
+    if (filename)
+        free(filename);
+    return retval;
+}
+
+/*! Compact a journaled db: write snapshot with journal replayed and remove journal
+ *
+ * @param[in]  h      Clixon handle
+ * @param[in]  db     Database name
+ * @param[in]  yspec  YANG spec
+ */
+static int
+journal_compact(clixon_handle h,
+                char         *db,
+                yang_stmt    *yspec)
+{
+    int    retval = -1;
+    cxobj *xt = NULL;
+    cbuf  *cbret = NULL;
+    char  *filename = NULL;
+    int    nr = 0;
+    int    ret;
+
+    if (journal_load(h, db, yspec, &xt, &nr) < 0)
+        goto done;
+    if (nr == 0)
+        goto ok;
+    if ((cbret = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    if (xml_name_set(xt, NETCONF_INPUT_CONFIG) < 0)
+        goto done;
+    if ((ret = trace_put(h, db, OP_REPLACE, xt, NULL, cbret)) < 0)
+        goto done;
+    if (ret == 0){
+        clixon_err(OE_DB, 0, "compact: %s", cbuf_get(cbret));
+        goto done;
+    }
+    if (journal_file(h, db, &filename) < 0)
+        goto done;
+    if (unlink(filename) < 0){
+        clixon_err(OE_UNIX, errno, "unlink(%s)", filename);
+        goto done;
+    }
+ ok:
+    retval = 0;
+ done:
+    if (filename)
+        free(filename);
+    if (cbret)
+        cbuf_free(cbret);
+    if (xt)
+        xml_free(xt);
+    return retval;
+}
+
+/*! Put to a journaled db, compact if the journal has grown past threshold
+ *
+ * The edit is checked before it is appended, since the journal is replayed without
+ * checks. Only create and delete need the current content for that.
+ * @param[in]  h         Clixon handle
+ * @param[in]  db        Database name
+ * @param[in]  op        Edit operation
+ * @param[in]  x1        Edit payload
+ * @param[in]  yspec     YANG spec
+ * @param[in]  threshold Journal size in bytes that triggers compaction
+ */
+static int
+journal_put(clixon_handle       h,
+            char               *db,
+            enum operation_type op,
+            cxobj              *x1,
+            yang_stmt          *yspec,
+            size_t              threshold)
+{
+    int         retval = -1;
+    char       *filename = NULL;
+    cxobj      *xt = NULL;
+    struct stat st;
+
+    if (datastore_check_nested(x1) < 0)
+        goto done;
+    if (op == OP_CREATE || op == OP_DELETE){
+        if (journal_load(h, db, yspec, &xt, NULL) < 0)
+            goto done;
+        if (datastore_check_exist(xt, x1, op) < 0)
+            goto done;
+    }
+    if (journal_append(h, db, op, x1, NULL) < 0)
+        goto done;
+    if (journal_file(h, db, &filename) < 0)
+        goto done;
+    if (stat(filename, &st) == 0 && st.st_size > threshold){
+        if (journal_compact(h, db, yspec) < 0)
+            goto done;
+    }
+    retval = 0;
+ done:
+    if (xt)
+        xml_free(xt);
+    if (filename)
+        free(filename);
+    return retval;
+}
+
+/*! Compare write amplification of journal appends with full db writes
+ *
+ * Both variants run nr merges of the XML in xmlfilename on a scratch copy of db.
+ * Bytes written per put are the record size for the journal, and the resulting db
+ * file size for a full write.
+ * @param[in]  h           Clixon handle
+ * @param[in]  db          Database name
+ * @param[in]  yspec       YANG spec
+ * @param[in]  xmlfilename XML payload of put
+ * @param[in]  nr          Number of puts
+ */
+static int
+journal_bench(clixon_handle h,
+              char         *db,
+              yang_stmt    *yspec,
+              char         *xmlfilename,
+              int           nr)
+{
+    int            retval = -1;
+    cxobj         *xput = NULL;
+    cxobj         *x1 = NULL;
+    cbuf          *cbret = NULL;
+    char          *dbfile = NULL;
+    char          *jfile = NULL;
+    struct stat    st;
+    struct timeval t0;
+    struct timeval t1;
+    struct timeval tj;
+    struct timeval tf;
+    uint64_t       jbytes = 0;
+    uint64_t       fbytes = 0;
+    size_t         len;
+    int            i;
+
+    if (xmlfilename == NULL){
+        clixon_err(OE_DB, 0, "jbench requires -x <xml>");
+        goto done;
+    }
+    if (datastore_xml_file(xmlfilename, yspec, &xput) < 0)
+        goto done;
+    if ((cbret = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    if (trace_copy(h, db, BENCH_COPY_DB) < 0)
+        goto done;
+    if (xmldb_db2file(h, BENCH_COPY_DB, &dbfile) < 0)
+        goto done;
+    if (journal_file(h, BENCH_COPY_DB, &jfile) < 0)
+        goto done;
+    unlink(jfile);
+    /* 1. Journal appends */
+    gettimeofday(&t0, NULL);
+    for (i=0; i<nr; i++){
+        if (journal_append(h, BENCH_COPY_DB, OP_MERGE, xput, &len) < 0)
+            goto done;
+        jbytes += len;
+    }
+    gettimeofday(&t1, NULL);
+    timersub(&t1, &t0, &tj);
+    /* 2. Full writes */
+    gettimeofday(&t0, NULL);
+    for (i=0; i<nr; i++){
+        if ((x1 = xml_dup(xput)) == NULL)
+            goto done;
+        cbuf_reset(cbret);
+        if (trace_put(h, BENCH_COPY_DB, OP_MERGE, x1, NULL, cbret) < 0)
+            goto done;
+        xml_free(x1);
+        x1 = NULL;
+        if (stat(dbfile, &st) == 0)
+            fbytes += st.st_size;
+    }
+    gettimeofday(&t1, NULL);
+    timersub(&t1, &t0, &tf);
+    if (nr > 0){
+        fprintf(stdout, "journal: puts: %d time: %lu.%06lu s bytes/put: %" PRIu64 "\n",
+                nr, tj.tv_sec, tj.tv_usec, jbytes/nr);
+        fprintf(stdout, "full:    puts: %d time: %lu.%06lu s bytes/put: %" PRIu64 "\n",
+                nr, tf.tv_sec, tf.tv_usec, fbytes/nr);
+        if (jbytes)
+            fprintf(stdout, "write amplification full/journal: %.1f\n", (double)fbytes/jbytes);
+    }
+    unlink(jfile);
+    if (xmldb_delete(h, BENCH_COPY_DB) < 0)
+        goto done;
+    retval = 0;
+ done:
+    if (jfile)
+        free(jfile);
+    if (dbfile)
+        free(dbfile);
+    if (cbret)
+        cbuf_free(cbret);
+    if (x1)
+        xml_free(x1);
+    if (xput)
+        xml_free(xput);
+    return retval;
+}
+
+/*! Filter datastore tree in place, keep only nodes matching xpath and their ancestors
+ *
+ * @param[in]  xt     XML tree
+ * @param[in]  xpath  XPath, if NULL or "/" keep the whole tree
+ */
+static int
+xml_filter_xpath(cxobj *xt,
+                 char  *xpath)
+{
+    int     retval = -1;
+    xp_ctx *xc = NULL;
+    int     i;
+
+    if (xpath == NULL || strcmp(xpath, "/") == 0)
+        goto ok;
+    if (xpath_vec_ctx(xt, NULL, xpath, 0, &xc) < 0)
+        goto done;
+    if (xc->xc_type == XT_NODESET)
+        for (i=0; i<xc->xc_size; i++)
+            xml_flag_set(xc->xc_nodeset[i], XML_FLAG_MARK);
+    if (xml_tree_prune_flagged_sub(xt, XML_FLAG_MARK, 1, NULL) < 0)
+        goto done;
+    if (xml_apply(xt, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset, (void*)XML_FLAG_MARK) < 0)
+        goto done;
+ ok:
+    retval = 0;
+ done:
+    if (xc)
+        ctx_free(xc);
+    return retval;
+}
+
+/*
+ * RESTCONF-style depth and fields filters of get (RFC 8040 4.8.2 and 4.8.3)
+ * Applied to each node selected by the get xpath, or each top-level node for "/".
+ * With -f binary and a simple xpath (no predicates), levels below depth are skipped
+ * while the db is read and never materialized. Otherwise the tree is pruned after
+ * the read: xmldb_get materializes the full selected tree.
+ */
+
+/*! Count nodes of a tree, of all types
+ */
+static int
+xml_nodes_count(cxobj *x)
+{
+    cxobj *xc;
+    int    n = 1;
+
+    xc = NULL;
+    while ((xc = xml_child_each(x, xc, -1)) != NULL)
+        n += xml_nodes_count(xc);
+    return n;
+}
+
+/*! Number of steps of a simple absolute location path, eg "/a/b" is 2 and "/" is 0
+ *
+ * @retval  n   Number of steps
+ * @retval -1   Not a simple path: has predicates, "//", unions, etc
+ */
+static int
+xpath_steps(char *xpath)
+{
+    char *s;
+    int   n = 0;
+
+    if (xpath == NULL || xpath[0] != '/' || strpbrk(xpath, "[]()|'\" ") != NULL ||
+        strstr(xpath, "//") != NULL)
+        return -1;
+    for (s = xpath; *s; s++)
+        if (*s == '/' && s[1] != '\0')
+            n++;
+    return n;
+}
+
+/*! Remove element children below depth levels, x itself is level 1
+ *
+ * Leaves at the last level keep their values
+ */
+static int
+xml_prune_depth(cxobj *x,
+                int    depth)
+{
+    cxobj *xc;
+    int    i;
+
+    i = xml_child_nr(x);
+    while (i-- > 0){
+        xc = xml_child_i(x, i);
+        if (xml_type(xc) != CX_ELMNT)
+            continue;
+        if (depth <= 1){
+            if (xml_purge(xc) < 0)
+                return -1;
+        }
+        else if (xml_prune_depth(xc, depth-1) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/*! Expand a RESTCONF fields expression into relative paths
+ *
+ * Example: "a/b;c(d;e)" gives "a/b", "c/d" and "c/e"
+ * @param[in]     prefix  Path of enclosing "(...)", or NULL
+ * @param[in,out] sp      Expression, on return first character not parsed
+ * @param[in]     cvv     Paths are added here as strings
+ */
+static int
+fields_parse(char  *prefix,
+             char **sp,
+             cvec  *cvv)
+{
+    int   retval = -1;
+    cbuf *cb = NULL;
+    char *s;
+    int   len;
+
+    if ((cb = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    while (1){
+        s = *sp;
+        len = strcspn(s, ";()");
+        if (len == 0){
+            clixon_err(OE_XML, EINVAL, "Invalid fields expression at: \"%s\"", s);
+            goto done;
+        }
+        cbuf_reset(cb);
+        if (prefix)
+            cprintf(cb, "%s/", prefix);
+        cprintf(cb, "%.*s", len, s);
+        *sp = s + len;
+        if (**sp == '('){
+            (*sp)++;
+            if (fields_parse(cbuf_get(cb), sp, cvv) < 0)
+                goto done;
+            if (**sp != ')'){
+                clixon_err(OE_XML, EINVAL, "Invalid fields expression: missing ')'");
+                goto done;
+            }
+            (*sp)++;
+        }
+        else if (cvec_add_string(cvv, NULL, cbuf_get(cb)) < 0){
+            clixon_err(OE_UNIX, errno, "cvec_add_string");
+            goto done;
+        }
+        if (**sp != ';')
+            break;
+        (*sp)++;
+    }
+    retval = 0;
+ done:
+    if (cb)
+        cbuf_free(cb);
+    return retval;
+}
+
+/*! Create namespace context for fields paths
+ *
+ * RESTCONF fields are prefixed with module names, eg "ietf-interfaces:interfaces".
+ * The context maps both module names and YANG prefixes to module namespaces.
+ * Unprefixed names are in the namespace of the selected node, which xml_prune_fields
+ * sets as default namespace.
+ * @param[in]  yspec  YANG spec
+ * @param[out] nscp   Namespace context, free with xml_nsctx_free
+ */
+static int
+fields_nsc(yang_stmt *yspec,
+           cvec     **nscp)
+{
+    yang_stmt *ymod;
+    char      *ns;
+
+    if (xml_nsctx_yangspec(yspec, nscp) < 0)
+        return -1;
+    ymod = NULL;
+    while ((ymod = yn_each(yspec, ymod)) != NULL){
+        if (yang_keyword_get(ymod) != Y_MODULE ||
+            (ns = yang_find_mynamespace(ymod)) == NULL)
+            continue;
+        if (xml_nsctx_add(*nscp, yang_argument_get(ymod), ns) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/*! Keep only the fields of x: nodes on paths relative to x and their descendants
+ *
+ * @param[in]  x      Selected node
+ * @param[in]  fields Relative paths, from fields_parse
+ * @param[in]  nsc    Namespace context of fields prefixes, from fields_nsc
+ */
+static int
+xml_prune_fields(cxobj *x,
+                 cvec  *fields,
+                 cvec  *nsc)
+{
+    int     retval = -1;
+    xp_ctx *xc = NULL;
+    cg_var *cv;
+    char   *ns = NULL;
+    int     i;
+
+    if (xml2ns(x, xml_prefix(x), &ns) < 0)
+        goto done;
+    if (ns && xml_nsctx_add(nsc, NULL, ns) < 0)
+        goto done;
+    cv = NULL;
+    while ((cv = cvec_each(fields, cv)) != NULL){
+        if (xpath_vec_ctx(x, nsc, cv_string_get(cv), 0, &xc) < 0)
+            goto done;
+        if (xc->xc_type == XT_NODESET)
+            for (i=0; i<xc->xc_size; i++)
+                xml_flag_set(xc->xc_nodeset[i], XML_FLAG_MARK);
+        ctx_free(xc);
+        xc = NULL;
+    }
+    if (xml_tree_prune_flagged_sub(x, XML_FLAG_MARK, 1, NULL) < 0)
+        goto done;
+    if (xml_apply(x, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset, (void*)XML_FLAG_MARK) < 0)
+        goto done;
+    retval = 0;
+ done:
+    if (xc)
+        ctx_free(xc);
+    return retval;
+}
+
+/*! Apply depth and fields filters to the nodes selected by xpath in a get result
+ *
+ * @param[in]  xt     Get result tree
+ * @param[in]  xpath  XPath of get
+ * @param[in]  depth  Depth filter, 0 if none
+ * @param[in]  fields Fields paths, or NULL
+ * @param[in]  yspec  YANG spec, for module prefixes in fields
+ */
+static int
+xml_filter_restconf(cxobj     *xt,
+                    char      *xpath,
+                    int        depth,
+                    cvec      *fields,
+                    yang_stmt *yspec)
+{
+    int     retval = -1;
+    xp_ctx *xc = NULL;
+    cvec   *nsc = NULL;
+    cxobj **vec = NULL;
+    int     len = 0;
+    cxobj  *x;
+    int     i;
+
+    if (xpath == NULL || strcmp(xpath, "/") == 0){
+        x = NULL;
+        while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL)
+            len++;
+        if (len && (vec = calloc(len, sizeof(cxobj*))) == NULL){
+            clixon_err(OE_UNIX, errno, "calloc");
+            goto done;
+        }
+        for (i=0; i<len; i++)
+            vec[i] = xml_child_each(xt, i?vec[i-1]:NULL, CX_ELMNT);
+    }
+    else {
+        if (xpath_vec_ctx(xt, NULL, xpath, 0, &xc) < 0)
+            goto done;
+        if (xc->xc_type == XT_NODESET){
+            vec = xc->xc_nodeset;
+            len = xc->xc_size;
+        }
+    }
+    if (fields && fields_nsc(yspec, &nsc) < 0)
+        goto done;
+    for (i=0; i<len; i++){
+        if (fields && xml_prune_fields(vec[i], fields, nsc) < 0)
+            goto done;
+        if (depth > 0 && xml_prune_depth(vec[i], depth) < 0)
+            goto done;
+    }
+    retval = 0;
+ done:
+    if (nsc)
+        xml_nsctx_free(nsc);
+    if (xc)
+        ctx_free(xc);
+    else if (vec)
+        free(vec);
+    return retval;
+}
+
+/*
+ * Binary datastore format (-f binary)
+ * The tree is stored in "<dbfile>.bin" as a flat pre-order array of fixed-size node
+ * records followed by a string pool. Element, attribute and prefix names are interned
+ * in the pool, ie stored once. The file is mmap:ed and walked without a text parser,
+ * and is materialized into cxobj only when needed.
+ * Integers are in host byte order, ie the file is not portable between architectures.
+ */
+#define BIN_MAGIC   "CXBN"
+#define BIN_VERSION 1
+#define BIN_NONE    0xffffffff
+
+/*! Binary file header
+ */
+struct bin_header {
+    char     bh_magic[4];  /* BIN_MAGIC */
+    uint32_t bh_version;   /* BIN_VERSION */
+    uint32_t bh_nnodes;    /* Number of node records following header */
+    uint32_t bh_poolsize;  /* Size of string pool following node records */
+};
+
+/*! Binary node record, nodes are stored in pre-order
+ */
+struct bin_node {
+    uint32_t bn_type;      /* enum cxobj_type */
+    uint32_t bn_name;      /* Pool offset of name */
+    uint32_t bn_prefix;    /* Pool offset of prefix, or BIN_NONE */
+    uint32_t bn_value;     /* Pool offset of value, or BIN_NONE */
+    uint32_t bn_nchild;    /* Number of direct children */
+};
+
+/*! Binary tree under construction, or mapped from file
+ */
+struct bin_tree {
+    struct bin_node *bt_nodes;
+    uint32_t         bt_nnodes;
+    char            *bt_pool;
+    uint32_t         bt_poolsize;
+    clicon_hash_t   *bt_names;  /* Interned names: name -> pool offset (write only) */
+    void            *bt_map;    /* mmap:ed file (read only) */
+    size_t           bt_maplen;
+};
+
+/*! Add a string to the pool of a binary tree
+ *
+ * @param[in]  bt      Binary tree
+ * @param[in]  str     String, or NULL
+ * @param[in]  intern  If set, reuse an existing copy of the string
+ * @param[out] offp    Pool offset, or BIN_NONE if str is NULL
+ */
+static int
+bin_pool_add(struct bin_tree *bt,
+             char            *str,
+             int              intern,
+             uint32_t        *offp)
+{
+    int       retval = -1;
+    size_t    len;
+    uint32_t *p;
+    size_t    vlen;
+
+    if (str == NULL){
+        *offp = BIN_NONE;
+        goto ok;
+    }
+    if (intern && (p = clicon_hash_value(bt->bt_names, str, &vlen)) != NULL){
+        *offp = *p;
+        goto ok;
+    }
+    len = strlen(str) + 1;
+    if ((bt->bt_pool = realloc(bt->bt_pool, bt->bt_poolsize + len)) == NULL){
+        clixon_err(OE_UNIX, errno, "realloc");
+        goto done;
+    }
+    memcpy(bt->bt_pool + bt->bt_poolsize, str, len);
+    *offp = bt->bt_poolsize;
+    bt->bt_poolsize += len;
+    if (intern && clicon_hash_add(bt->bt_names, str, offp, sizeof(*offp)) == NULL)
+        goto done;
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Encode an XML subtree in pre-order into a binary tree
+ */
+static int
+bin_encode(struct bin_tree *bt,
+           cxobj           *x)
+{
+    int              retval = -1;
+    struct bin_node *bn;
+    uint32_t         i;
+    cxobj           *xc;
+
+    if ((bt->bt_nnodes % 1024) == 0 &&
+        (bt->bt_nodes = realloc(bt->bt_nodes, (bt->bt_nnodes+1024)*sizeof(*bn))) == NULL){
+        clixon_err(OE_UNIX, errno, "realloc");
+        goto done;
+    }
+    i = bt->bt_nnodes++;
+    bn = &bt->bt_nodes[i];
+    bn->bn_type = xml_type(x);
+    bn->bn_nchild = xml_child_nr(x);
+    if (bin_pool_add(bt, xml_name(x), 1, &bn->bn_name) < 0)
+        goto done;
+    if (bin_pool_add(bt, xml_prefix(x), 1, &bn->bn_prefix) < 0)
+        goto done;
+    if (bin_pool_add(bt, xml_type(x)==CX_ELMNT?NULL:xml_value(x), 0, &bn->bn_value) < 0)
+        goto done;
+    xc = NULL;
+    while ((xc = xml_child_each(x, xc, -1)) != NULL)
+        if (bin_encode(bt, xc) < 0)
+            goto done;
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Write an XML tree to a file in binary format
+ *
+ * The file is written to a temporary file which is then renamed, so readers never
+ * see a partially written file.
+ * @param[in]  filename  Binary file
+ * @param[in]  xt        XML tree
+ */
+static int
+bin_write(char  *filename,
+          cxobj *xt)
+{
+    int               retval = -1;
+    struct bin_tree   bt = {0,};
+    struct bin_header bh = {BIN_MAGIC, BIN_VERSION,};
+    cbuf             *cb = NULL;
+    FILE             *fp = NULL;
+
+    if ((bt.bt_names = clicon_hash_init()) == NULL)
+        goto done;
+    if (bin_encode(&bt, xt) < 0)
+        goto done;
+    bh.bh_nnodes = bt.bt_nnodes;
+    bh.bh_poolsize = bt.bt_poolsize;
+    if ((cb = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    cprintf(cb, "%s.tmp", filename);
+    if ((fp = fopen(cbuf_get(cb), "w")) == NULL){
+        clixon_err(OE_UNIX, errno, "fopen(%s)", cbuf_get(cb));
+        goto done;
+    }
+    if (fwrite(&bh, sizeof(bh), 1, fp) != 1 ||
+        fwrite(bt.bt_nodes, sizeof(struct bin_node), bt.bt_nnodes, fp) != bt.bt_nnodes ||
+        fwrite(bt.bt_pool, 1, bt.bt_poolsize, fp) != bt.bt_poolsize ||
+        fflush(fp) != 0 ||
+        fsync(fileno(fp)) < 0){
+        clixon_err(OE_UNIX, errno, "write(%s)", cbuf_get(cb));
+        goto done;
+    }
+    fclose(fp);
+    fp = NULL;
+    if (rename(cbuf_get(cb), filename) < 0){
+        clixon_err(OE_UNIX, errno, "rename(%s)", filename);
+        goto done;
+    }
+    retval = 0;
+ done:
+    if (fp)
+        fclose(fp);
+    if (cb)
+        cbuf_free(cb);
+    if (bt.bt_names)
+        clicon_hash_free(bt.bt_names);
+    if (bt.bt_nodes)
+        free(bt.bt_nodes);
+    if (bt.bt_pool)
+        free(bt.bt_pool);
+    return retval;
+}
+
+/*! Map a binary file into memory and check its header
+ *
+ * @param[in]  filename  Binary file
+ * @param[out] bt        Binary tree referring to mapped file, unmap with bin_unmap
+ */
+static int
+bin_map(char            *filename,
+        struct bin_tree *bt)
+{
+    int                retval = -1;
+    int                fd = -1;
+    struct stat        st;
+    struct bin_header *bh;
+
+    memset(bt, 0, sizeof(*bt));
+    if ((fd = open(filename, O_RDONLY)) < 0){
+        clixon_err(OE_UNIX, errno, "open(%s)", filename);
+        goto done;
+    }
+    if (fstat(fd, &st) < 0){
+        clixon_err(OE_UNIX, errno, "fstat(%s)", filename);
+        goto done;
+    }
+    if (st.st_size < sizeof(*bh)){
+        clixon_err(OE_DB, 0, "%s: not a binary datastore", filename);
+        goto done;
+    }
+    if ((bt->bt_map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED){
+        bt->bt_map = NULL;
+        clixon_err(OE_UNIX, errno, "mmap(%s)", filename);
+        goto done;
+    }
+    bt->bt_maplen = st.st_size;
+    bh = (struct bin_header *)bt->bt_map;
+    if (memcmp(bh->bh_magic, BIN_MAGIC, 4) != 0 ||
+        bh->bh_version != BIN_VERSION ||
+        sizeof(*bh) + (uint64_t)bh->bh_nnodes*sizeof(struct bin_node) + bh->bh_poolsize != st.st_size ||
+        bh->bh_nnodes == 0){
+        clixon_err(OE_DB, 0, "%s: not a binary datastore or bad version", filename);
+        goto done;
+    }
+    bt->bt_nnodes = bh->bh_nnodes;
+    bt->bt_nodes = (struct bin_node *)(bh + 1);
+    bt->bt_poolsize = bh->bh_poolsize;
+    bt->bt_pool = (char *)(bt->bt_nodes + bt->bt_nnodes);
+    retval = 0;
+ done:
+    if (fd != -1)
+        close(fd);
+    return retval;
+}
+
+static void
+bin_unmap(struct bin_tree *bt)
+{
+    if (bt->bt_map)
+        munmap(bt->bt_map, bt->bt_maplen);
+    memset(bt, 0, sizeof(*bt));
+}
+
+/*! Get pool string of a mapped binary tree, check bounds
+ */
+static char *
+bin_str(struct bin_tree *bt,
+        uint32_t         off)
+{
+    if (off == BIN_NONE || off >= bt->bt_poolsize)
+        return NULL;
+    if (memchr(bt->bt_pool + off, '\0', bt->bt_poolsize - off) == NULL)
+        return NULL;
+    return bt->bt_pool + off;
+}
+
+/*! Walk a subtree of a mapped binary tree without materializing it
+ *
+ * @param[in]     bt  Mapped binary tree
+ * @param[in,out] ip  Index of subtree root, on return index of next sibling
+ * @retval        n   Number of nodes in subtree
+ * @retval       -1   Error: corrupt file
+ */
+static int
+bin_walk(struct bin_tree *bt,
+         uint32_t        *ip)
+{
+    struct bin_node *bn;
+    uint32_t         i;
+    int              n = 1;
+    int              ret;
+
+    if (*ip >= bt->bt_nnodes){
+        clixon_err(OE_DB, 0, "Corrupt binary datastore");
+        return -1;
+    }
+    bn = &bt->bt_nodes[(*ip)++];
+    for (i=0; i<bn->bn_nchild; i++){
+        if ((ret = bin_walk(bt, ip)) < 0)
+            return -1;
+        n += ret;
+    }
+    return n;
+}
+
+/*! Materialize a subtree of a mapped binary tree into XML
+ *
+ * Element children deeper than depth are skipped without being materialized
+ * @param[in]     bt    Mapped binary tree
+ * @param[in,out] ip    Index of subtree root, on return index of next sibling
+ * @param[in]     xp    XML parent, or NULL for root
+ * @param[in]     depth Element levels below the subtree root to decode, -1 for all
+ * @param[out]    xnp   Created XML node (if not NULL)
+ */
+static int
+bin_decode(struct bin_tree *bt,
+           uint32_t        *ip,
+           cxobj           *xp,
+           int              depth,
+           cxobj          **xnp)
+{
+    int              retval = -1;
+    struct bin_node *bn;
+    cxobj           *x;
+    char            *name;
+    char            *str;
+    uint32_t         i;
+
+    if (*ip >= bt->bt_nnodes){
+        clixon_err(OE_DB, 0, "Corrupt binary datastore");
+        goto done;
+    }
+    bn = &bt->bt_nodes[(*ip)++];
+    if ((name = bin_str(bt, bn->bn_name)) == NULL ||
+        bn->bn_type > CX_BODY){
+        clixon_err(OE_DB, 0, "Corrupt binary datastore");
+        goto done;
+    }
+    if ((x = xml_new(name, xp, (enum cxobj_type)bn->bn_type)) == NULL)
+        goto done;
+    if (xnp)
+        *xnp = x;
+    if ((str = bin_str(bt, bn->bn_prefix)) != NULL &&
+        xml_prefix_set(x, str) < 0)
+        goto done;
+    if ((str = bin_str(bt, bn->bn_value)) != NULL &&
+        xml_value_set(x, str) < 0)
+        goto done;
+    for (i=0; i<bn->bn_nchild; i++){
+        if (depth == 0 && *ip < bt->bt_nnodes &&
+            bt->bt_nodes[*ip].bn_type == CX_ELMNT){
+            if (bin_walk(bt, ip) < 0)
+                goto done;
+        }
+        else if (bin_decode(bt, ip, x, depth>0?depth-1:depth, NULL) < 0)
+            goto done;
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Load a binary file into an XML tree bound to YANG
+ *
+ * @param[in]  h         Clixon handle
+ * @param[in]  filename  Binary file
+ * @param[in]  yspec     YANG spec
+ * @param[in]  depth     Element levels below top to load, -1 for all
+ * @param[out] xtp       XML tree, free with xml_free
+ */
+static int
+bin_load(clixon_handle h,
+         char         *filename,
+         yang_stmt    *yspec,
+         int           depth,
+         cxobj       **xtp)
+{
+    int             retval = -1;
+    struct bin_tree bt = {0,};
+    cxobj          *xt = NULL;
+    cxobj          *xerr = NULL;
+    uint32_t        i = 0;
+    int             ret;
+
+    if (bin_map(filename, &bt) < 0)
+        goto done;
+    if (bin_decode(&bt, &i, NULL, depth, &xt) < 0)
+        goto done;
+    if ((ret = xml_bind_yang(h, xt, YB_MODULE, yspec, 0, &xerr)) < 0)
+        goto done;
+    if (ret == 0){
+        clixon_err_netconf(h, OE_XML, 0, xerr, "%s", filename);
+        goto done;
+    }
+    *xtp = xt;
+    xt = NULL;
+    retval = 0;
+ done:
+    bin_unmap(&bt);
+    if (xerr)
+        xml_free(xerr);
+    if (xt)
+        xml_free(xt);
+    return retval;
+}
+
+/*! Get name of binary file of a db
+ */
+static int
+bin_file(clixon_handle h,
+         char         *db,
+         char        **filename)
+{
+    return db_sidefile(h, db, ".bin", filename);
+}
+
+/*! Load a binary db, an empty tree if it does not exist
+ *
+ * @param[in]  h      Clixon handle
+ * @param[in]  db     Database name
+ * @param[in]  yspec  YANG spec
+ * @param[in]  depth  Element levels below top to load, -1 for all
+ * @param[out] xtp    XML tree, free with xml_free
+ */
+static int
+bin_db_load(clixon_handle h,
+            char         *db,
+            yang_stmt    *yspec,
+            int           depth,
+            cxobj       **xtp)
+{
+    int         retval = -1;
+    char       *filename = NULL;
+    struct stat st;
+
+    if (bin_file(h, db, &filename) < 0)
+        goto done;
+    if (stat(filename, &st) < 0){
+        if ((*xtp = xml_new(NETCONF_INPUT_CONFIG, NULL, CX_ELMNT)) == NULL)
+            goto done;
+    }
+    else if (bin_load(h, filename, yspec, depth, xtp) < 0)
+        goto done;
+    retval = 0;
+ done:
+    if (filename)
+        free(filename);
+    return retval;
+}
+
+/*! Put to a binary db: load, apply edit in memory, and write
+ */
+static int
+bin_db_put(clixon_handle       h,
+           char               *db,
+           enum operation_type op,
+           cxobj              *x1,
+           yang_stmt          *yspec)
+{
+    int    retval = -1;
+    char  *filename = NULL;
+    cxobj *xt = NULL;
+
+    if (bin_db_load(h, db, yspec, -1, &xt) < 0)
+        goto done;
+    if (datastore_apply(xt, op, x1, yspec, 1) < 0)
+        goto done;
+    if (xml_sort_recurse(xt) < 0)
+        goto done;
+    if (bin_file(h, db, &filename) < 0)
+        goto done;
+    if (bin_write(filename, xt) < 0)
+        goto done;
+    retval = 0;
+ done:
+    if (xt)
+        xml_free(xt);
+    if (filename)
+        free(filename);
+    return retval;
+}
+
+/*! Load a standalone file in xml, json or binary format
+ *
+ * @param[in]  h         Clixon handle
+ * @param[in]  filename  File
+ * @param[in]  fmt       Format: xml, json or binary
+ * @param[in]  yspec     YANG spec
+ * @param[out] xtp       XML tree, free with xml_free
+ */
+static int
+datastore_file_load(clixon_handle h,
+                    char         *filename,
+                    char         *fmt,
+                    yang_stmt    *yspec,
+                    cxobj       **xtp)
+{
+    int    retval = -1;
+    FILE  *fp = NULL;
+    cxobj *xerr = NULL;
+    int    ret;
+
+    if (strcmp(fmt, "binary") == 0)
+        return bin_load(h, filename, yspec, -1, xtp);
+    if ((fp = fopen(filename, "r")) == NULL){
+        clixon_err(OE_UNIX, errno, "fopen(%s)", filename);
+        goto done;
+    }
+    if (strcmp(fmt, "json") == 0)
+        ret = clixon_json_parse_file(fp, 1, YB_MODULE, yspec, xtp, &xerr);
+    else if (strcmp(fmt, "xml") == 0)
+        ret = clixon_xml_parse_file(fp, YB_MODULE, yspec, xtp, &xerr);
+    else {
+        clixon_err(OE_DB, 0, "Unsupported format: %s", fmt);
+        goto done;
+    }
+    if (ret < 0)
+        goto done;
+    if (ret == 0){
+        clixon_err_netconf(h, OE_XML, 0, xerr, "%s", filename);
+        goto done;
+    }
+    retval = 0;
+ done:
+    if (xerr)
+        xml_free(xerr);
+    if (fp)
+        fclose(fp);
+    return retval;
+}
+
+/*! Write an XML tree to a standalone file in xml, json or binary format
+ */
+static int
+datastore_file_write(char  *filename,
+                     char  *fmt,
+                     cxobj *xt)
+{
+    int   retval = -1;
+    FILE *fp = NULL;
+
+    if (strcmp(fmt, "binary") == 0)
+        return bin_write(filename, xt);
+    if ((fp = fopen(filename, "w")) == NULL){
+        clixon_err(OE_UNIX, errno, "fopen(%s)", filename);
+        goto done;
+    }
+    if (strcmp(fmt, "json") == 0){
+        if (clixon_json2file(fp, xt, 1, fprintf, 1, 0) < 0)
+            goto done;
+    }
+    else if (strcmp(fmt, "xml") == 0){
+        if (clixon_xml2file(fp, xt, 0, 1, NULL, fprintf, 1, 0) < 0)
+            goto done;
+    }
+    else {
+        clixon_err(OE_DB, 0, "Unsupported format: %s", fmt);
+        goto done;
+    }
+    retval = 0;
+ done:
+    if (fp)
+        fclose(fp);
+    return retval;
+}
+
+/*! Measure cold-load time of a file in xml, json or binary format
+ *
+ * For binary, also measure a walk of the mapped file without materializing XML
+ * @param[in]  h         Clixon handle
+ * @param[in]  filename  File
+ * @param[in]  fmt       Format: xml, json or binary
+ * @param[in]  yspec     YANG spec
+ * @param[in]  nr        Number of loads
+ */
+static int
+datastore_coldload(clixon_handle h,
+                   char         *filename,
+                   char         *fmt,
+                   yang_stmt    *yspec,
+                   int           nr)
+{
+    int             retval = -1;
+    cxobj          *xt = NULL;
+    struct bin_tree bt;
+    struct stat     st;
+    struct timeval  t0;
+    struct timeval  t1;
+    struct timeval  td;
+    uint32_t        idx;
+    int             nodes = 0;
+    int             i;
+
+    if (nr < 1)
+        nr = 1;
+    if (stat(filename, &st) < 0){
+        clixon_err(OE_UNIX, errno, "stat(%s)", filename);
+        goto done;
+    }
+    gettimeofday(&t0, NULL);
+    for (i=0; i<nr; i++){
+        if (datastore_file_load(h, filename, fmt, yspec, &xt) < 0)
+            goto done;
+        xml_free(xt);
+        xt = NULL;
+    }
+    gettimeofday(&t1, NULL);
+    timersub(&t1, &t0, &td);
+    fprintf(stdout, "%s: size: %lu bytes load: %" PRIu64 " usec\n",
+            fmt, (unsigned long)st.st_size, timeval2usec(&td)/nr);
+    if (strcmp(fmt, "binary") == 0){
+        gettimeofday(&t0, NULL);
+        for (i=0; i<nr; i++){
+            if (bin_map(filename, &bt) < 0)
+                goto done;
+            idx = 0;
+            nodes = bin_walk(&bt, &idx);
+            bin_unmap(&bt);
+            if (nodes < 0)
+                goto done;
+        }
+        gettimeofday(&t1, NULL);
+        timersub(&t1, &t0, &td);
+        fprintf(stdout, "%s: nodes: %d walk: %" PRIu64 " usec\n",
+                fmt, nodes, timeval2usec(&td)/nr);
+    }
+    retval = 0;
+ done:
+    if (xt)
+        xml_free(xt);
+    return retval;
+}
+
+/*
+ * Datastore content hashes
+ * After a write made via this utility, "<dbfile>.hash" is written with the version stamp
+ * of the db file, a hash of the whole content and one hash per top-level subtree:
+ *   stamp <mtime sec>.<mtime nsec> <size> <inode>
+ *   hash <hex>
+ *   <hex> <module>:<name>
+ * A subtree hash is FNV-1a of its serialized XML, the content hash is FNV-1a of the
+ * subtree lines. The db file is sorted, so equal content gives equal hashes.
+ * The hash file is valid as long as the stamp matches the db file, which needs only a
+ * stat. Otherwise (eg written by another process) it is recomputed from the db.
+ * Only the default xmldb format (not -f journal or binary).
+ */
+/*! Get name of content hash file of a db
+ */
+static int
+hash_file(clixon_handle h,
+          char         *db,
+          char        **filename)
+{
+    return db_sidefile(h, db, ".hash", filename);
+}
+
+/*! Compute content hash and per top-level subtree hashes of a db tree
+ *
+ * @param[in]  xt    Datastore tree
+ * @param[out] cb    Subtree hash lines, "<hex> <module>:<name>\n"
+ * @param[out] hash  Content hash
+ */
+static int
+hash_compute(cxobj    *xt,
+             cbuf     *cb,
+             uint64_t *hash)
+{
+    int        retval = -1;
+    cbuf      *cbx = NULL;
+    cxobj     *x;
+    yang_stmt *ym;
+
+    if ((cbx = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    x = NULL;
+    while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL){
+        cbuf_reset(cbx);
+        if (clixon_xml2cbuf(cbx, x, 0, 0, NULL, -1, 0) < 0)
+            goto done;
+        cprintf(cb, "%016" PRIx64 " ", fnv1a(FNV1A_OFFSET, cbuf_get(cbx), cbuf_len(cbx)));
+        if (xml_spec(x) && (ym = ys_module(xml_spec(x))) != NULL)
+            cprintf(cb, "%s:", yang_argument_get(ym));
+        cprintf(cb, "%s\n", xml_name(x));
+    }
+    *hash = fnv1a(FNV1A_OFFSET, cbuf_get(cb), cbuf_len(cb));
+    retval = 0;
+ done:
+    if (cbx)
+        cbuf_free(cbx);
+    return retval;
+}
+
+/*! Write hash file of a db
+ *
+ * @param[in]  h     Clixon handle
+ * @param[in]  db    Database name
+ * @param[in]  stamp Version of db file the hashes were computed from
+ * @param[in]  hash  Content hash
+ * @param[in]  cbsub Subtree hash lines
+ */
+static int
+hash_store(clixon_handle    h,
+           char            *db,
+           struct ds_stamp *stamp,
+           uint64_t         hash,
+           cbuf            *cbsub)
+{
+    int             retval = -1;
+    char           *filename = NULL;
+    char           *tmpfile = NULL;
+    FILE           *f = NULL;
+
+    if (hash_file(h, db, &filename) < 0)
+        goto done;
+    if (db_sidefile(h, db, ".hash.tmp", &tmpfile) < 0)
+        goto done;
+    if ((f = fopen(tmpfile, "w")) == NULL){
+        clixon_err(OE_UNIX, errno, "fopen(%s)", tmpfile);
+        goto done;
+    }
+    fprintf(f, "stamp %lu.%09lu %lu.%09lu %lu %lu\n",
+            (unsigned long)stamp->ds_mtime.tv_sec, (unsigned long)stamp->ds_mtime.tv_nsec,
+            (unsigned long)stamp->ds_ctime.tv_sec, (unsigned long)stamp->ds_ctime.tv_nsec,
+            (unsigned long)stamp->ds_size, (unsigned long)stamp->ds_ino);
+    fprintf(f, "hash %016" PRIx64 "\n", hash);
+    fprintf(f, "%s", cbuf_get(cbsub));
+    if (fclose(f) < 0){
+        f = NULL;
+        clixon_err(OE_UNIX, errno, "fclose(%s)", tmpfile);
+        goto done;
+    }
+    f = NULL;
+    if (rename(tmpfile, filename) < 0){
+        clixon_err(OE_UNIX, errno, "rename(%s)", filename);
+        goto done;
+    }
+    retval = 0;
+ done:
+    if (f)
+        fclose(f);
+    if (tmpfile)
+        free(tmpfile);
+    if (filename)
+        free(filename);
+    return retval;
+}
+
+/*! Compute hashes of a db and write its hash file
+ *
+ * @param[in]  h     Clixon handle
+ * @param[in]  db    Database name
+ * @param[out] hash  Content hash (if not NULL)
+ * @param[out] cb    Subtree hash lines (if not NULL)
+ */
+static int
+hash_write(clixon_handle h,
+           char         *db,
+           uint64_t     *hash,
+           cbuf         *cb)
+{
+    int             retval = -1;
+    struct ds_stamp stamp;
+    cxobj          *xt = NULL;
+    cbuf           *cbsub = NULL;
+    uint64_t        top;
+
+    if (ds_stamp_get(h, db, &stamp) < 0)
+        goto done;
+    if (trace_get(h, db, NULL, "/", &xt) < 0)
+        goto done;
+    if ((cbsub = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    if (hash_compute(xt, cbsub, &top) < 0)
+        goto done;
+    if (hash_store(h, db, &stamp, top, cbsub) < 0)
+        goto done;
+    if (hash)
+        *hash = top;
+    if (cb)
+        cprintf(cb, "%s", cbuf_get(cbsub));
+    retval = 0;
+ done:
+    if (cbsub)
+        cbuf_free(cbsub);
+    if (xt)
+        xml_free(xt);
+    return retval;
+}
+
+/*! Read hash file of a db, without reading the db itself
+ *
+ * The hash file is valid if the db file has the mtime, ctime, size and inode it was
+ * computed from. That does not catch a rewrite within the same timestamp tick as the
+ * hash was computed in, with equal size. As git does for its index, a db file
+ * modified no earlier than the hash file was written is therefore racy, and its
+ * hash is recomputed.
+ * @param[in]  h     Clixon handle
+ * @param[in]  db    Database name
+ * @param[out] hash  Content hash
+ * @param[out] cb    Subtree hash lines (if not NULL)
+ * @retval     1     OK, hash file is valid
+ * @retval     0     Hash file does not exist or does not match db file
+ * @retval    -1     Error
+ */
+static int
+hash_read(clixon_handle h,
+          char         *db,
+          uint64_t     *hash,
+          cbuf         *cb)
+{
+    int             retval = -1;
+    struct ds_stamp stamp;
+    char           *filename = NULL;
+    FILE           *f = NULL;
+    unsigned long   sec;
+    unsigned long   nsec;
+    unsigned long   csec;
+    unsigned long   cnsec;
+    unsigned long   size;
+    unsigned long   ino;
+    char           *line = NULL;
+    size_t          linelen = 0;
+    struct stat     st;
+
+    if (ds_stamp_get(h, db, &stamp) < 0)
+        goto done;
+    if (hash_file(h, db, &filename) < 0)
+        goto done;
+    if ((f = fopen(filename, "r")) == NULL){
+        retval = 0;
+        goto done;
+    }
+    if (fscanf(f, "stamp %lu.%lu %lu.%lu %lu %lu\n", &sec, &nsec, &csec, &cnsec, &size, &ino) != 6 ||
+        fscanf(f, "hash %" SCNx64 "\n", hash) != 1){
+        retval = 0;
+        goto done;
+    }
+    if (stamp.ds_size == 0 && stamp.ds_ino == 0){ /* db file does not exist */
+        retval = 0;
+        goto done;
+    }
+    if (sec != (unsigned long)stamp.ds_mtime.tv_sec ||
+        nsec != (unsigned long)stamp.ds_mtime.tv_nsec ||
+        csec != (unsigned long)stamp.ds_ctime.tv_sec ||
+        cnsec != (unsigned long)stamp.ds_ctime.tv_nsec ||
+        size != (unsigned long)stamp.ds_size ||
+        ino != (unsigned long)stamp.ds_ino){
+        retval = 0;
+        goto done;
+    }
+    /* Racy: db modified in the same tick as, or after, the hash was written */
+    if (fstat(fileno(f), &st) < 0 ||
+        stamp.ds_mtime.tv_sec > st.st_mtim.tv_sec ||
+        (stamp.ds_mtime.tv_sec == st.st_mtim.tv_sec &&
+         stamp.ds_mtime.tv_nsec >= st.st_mtim.tv_nsec)){
+        retval = 0;
+        goto done;
+    }
+    if (cb)
+        while (getline(&line, &linelen, f) != -1)
+            cprintf(cb, "%s", line);
+    retval = 1;
+ done:
+    if (line)
+        free(line);
+    if (f)
+        fclose(f);
+    if (filename)
+        free(filename);
+    return retval;
+}
+
+/*! Get content hash of a db, from its hash file if valid, otherwise recompute it
+ *
+ * @param[in]  h     Clixon handle
+ * @param[in]  db    Database name
+ * @param[out] hash  Content hash
+ * @param[out] cb    Subtree hash lines (if not NULL)
+ * @retval     1     OK, read from hash file
+ * @retval     0     OK, recomputed from db
+ * @retval    -1     Error
+ */
+static int
+hash_get(clixon_handle h,
+         char         *db,
+         uint64_t     *hash,
+         cbuf         *cb)
+{
+    int ret;
+
+    if ((ret = hash_read(h, db, hash, cb)) < 0)
+        return -1;
+    if (ret == 1)
+        return 1;
+    if (cb)
+        cbuf_reset(cb);
+    if (hash_write(h, db, hash, cb) < 0)
+        return -1;
+    return 0;
+}
+
+/*! Load the whole tree of a db, in journal, binary or xmldb format
+ *
+ * @param[in]  h        Clixon handle
+ * @param[in]  db       Database name
+ * @param[in]  yspec    YANG spec
+ * @param[in]  journal  Journal format
+ * @param[in]  binary   Binary format
+ * @param[out] xtp      Datastore tree, free with xml_free
+ */
+static int
+datastore_load(clixon_handle h,
+               char         *db,
+               yang_stmt    *yspec,
+               int           journal,
+               int           binary,
+               cxobj       **xtp)
+{
+    if (journal)
+        return journal_load(h, db, yspec, xtp, NULL);
+    else if (binary)
+        return bin_db_load(h, db, yspec, -1, xtp);
+    else
+        return trace_get(h, db, NULL, "/", xtp);
+}
+
+/*! Sync the db file to disk
+ *
+ * xmldb_put writes the db file but does not sync it
+ * @param[in]  h   Clixon handle
+ * @param[in]  db  Database name
+ */
+static int
+db_fsync(clixon_handle h,
+         char         *db)
+{
+    int   retval = -1;
+    char *filename = NULL;
+    int   fd = -1;
+
+    if (xmldb_db2file(h, db, &filename) < 0)
+        goto done;
+    if ((fd = open(filename, O_RDONLY)) < 0){
+        clixon_err(OE_UNIX, errno, "open(%s)", filename);
+        goto done;
+    }
+    if (fsync(fd) < 0){
+        clixon_err(OE_UNIX, errno, "fsync(%s)", filename);
+        goto done;
+    }
+    retval = 0;
+ done:
+    if (fd != -1)
+        close(fd);
+    if (filename)
+        free(filename);
+    return retval;
+}
+
+/*! Apply a stream of edits to the in-memory tree and write the db once at commit
+ *
+ * The transaction file has one edit per line: "<operation> <xml>", where operation
+ * is merge, replace, create, delete or remove. Empty lines and lines starting with '#'
+ * are skipped. Prints apply time of each edit, and the time to write and sync the db.
+ * @param[in]  h        Clixon handle
+ * @param[in]  db       Database name
+ * @param[in]  yspec    YANG spec
+ * @param[in]  filename Transaction file
+ * @param[in]  journal  Journal format
+ * @param[in]  binary   Binary format
+ */
+static int
+datastore_txn(clixon_handle h,
+              char         *db,
+              yang_stmt    *yspec,
+              char         *filename,
+              int           journal,
+              int           binary)
+{
+    int                 retval = -1;
+    FILE               *fp = NULL;
+    char               *line = NULL;
+    size_t              linelen = 0;
+    ssize_t             len;
+    char               *opstr;
+    char               *xmlstr;
+    enum operation_type op;
+    cxobj              *xt = NULL;
+    cxobj              *x1 = NULL;
+    cxobj              *xerr = NULL;
+    cbuf               *cbret = NULL;
+    char               *binfile = NULL;
+    char               *jfile = NULL;
+    struct timeval      t0;
+    struct timeval      t1;
+    struct timeval      td;
+    uint64_t            total = 0;
+    int                 nr = 0;
+    int                 ret;
+
+    if ((fp = fopen(filename, "r")) == NULL){
+        clixon_err(OE_UNIX, errno, "fopen(%s)", filename);
+        goto done;
+    }
+    if (datastore_load(h, db, yspec, journal, binary, &xt) < 0)
+        goto done;
+    while ((len = getline(&line, &linelen, fp)) != -1){
+        while (len > 0 && (line[len-1] == '\n' || line[len-1] == '\r'))
+            line[--len] = '\0';
+        opstr = line + strspn(line, " \t");
+        if (*opstr == '\0' || *opstr == '#')
+            continue;
+        xmlstr = opstr + strcspn(opstr, " \t");
+        if (*xmlstr != '\0')
+            *xmlstr++ = '\0';
+        if (xml_operation(opstr, &op) < 0){
+            clixon_err(OE_DB, 0, "%s: edit %d: unrecognized operation: %s", filename, nr, opstr);
+            goto done;
+        }
+        if ((ret = clixon_xml_parse_string(xmlstr, YB_MODULE, yspec, &x1, &xerr)) < 0)
+            goto done;
+        if (ret == 0){
+            clixon_err_netconf(h, OE_XML, 0, xerr, "%s: edit %d", filename, nr);
+            goto done;
+        }
+        gettimeofday(&t0, NULL);
+        if (datastore_apply(xt, op, x1, yspec, 1) < 0)
+            goto done;
+        gettimeofday(&t1, NULL);
+        timersub(&t1, &t0, &td);
+        total += timeval2usec(&td);
+        fprintf(stdout, "edit %d: %s apply: %" PRIu64 " usec\n", nr, opstr, timeval2usec(&td));
+        xml_free(x1);
+        x1 = NULL;
+        nr++;
+    }
+    /* Commit: one write and one sync */
+    gettimeofday(&t0, NULL);
+    if (binary){
+        if (bin_file(h, db, &binfile) < 0)
+            goto done;
+        if (bin_write(binfile, xt) < 0)
+            goto done;
+    }
+    else {
+        if ((cbret = cbuf_new()) == NULL){
+            clixon_err(OE_UNIX, errno, "cbuf_new");
+            goto done;
+        }
+        if (xml_name_set(xt, NETCONF_INPUT_CONFIG) < 0)
+            goto done;
+        if ((ret = trace_put(h, db, OP_REPLACE, xt, NULL, cbret)) < 0)
+            goto done;
+        if (ret == 0){
+            clixon_err(OE_DB, 0, "txn: %s", cbuf_get(cbret));
+            goto done;
+        }
+        if (db_fsync(h, db) < 0)
+            goto done;
+        if (journal){ /* Journal is replayed into the snapshot */
+            if (journal_file(h, db, &jfile) < 0)
+                goto done;
+            unlink(jfile);
+        }
+        else if (hash_write(h, db, NULL, NULL) < 0)
+            goto done;
+    }
+    gettimeofday(&t1, NULL);
+    timersub(&t1, &t0, &td);
+    fprintf(stdout, "edits: %d apply: %" PRIu64 " usec flush: %" PRIu64 " usec\n",
+            nr, total, timeval2usec(&td));
+    retval = 0;
+ done:
+    if (jfile)
+        free(jfile);
+    if (binfile)
+        free(binfile);
+    if (cbret)
+        cbuf_free(cbret);
+    if (xerr)
+        xml_free(xerr);
+    if (x1)
+        xml_free(x1);
+    if (xt)
+        xml_free(xt);
+    if (line)
+        free(line);
+    if (fp)
+        fclose(fp);
+    return retval;
+}
+
+/*
+ * Split datastore
+ * The db is stored in a directory "<dbfile>.d" with one XML file "<module>.xml" per
+ * YANG module with top-level data. A get only loads the files of the modules its xpath
+ * can touch, which is all modules unless the first xpath step is a named node.
+ * The split store is a copy written by the split command, it is not updated by put.
+ * Instead, a stamp file "<dbfile>.d/stamp" records the version of the source files it
+ * was written from, and a get on a stale split store rebuilds it first.
+ */
+
+/* Name of stamp file in split store directory */
+#define SPLIT_STAMP "stamp"
+
+/*! Get version stamp of the source files of a split store as a string
+ *
+ * Covers the file the db is loaded from in its format, and the journal if any
+ * @param[in]  h        Clixon handle
+ * @param[in]  db       Database name
+ * @param[in]  journal  Journal format
+ * @param[in]  binary   Binary format
+ * @param[out] cb       Stamp string is appended here
+ */
+static int
+split_stamp(clixon_handle h,
+            char         *db,
+            int           journal,
+            int           binary,
+            cbuf         *cb)
+{
+    int         retval = -1;
+    char       *files[2] = {NULL, NULL};
+    struct stat st;
+    int         i;
+
+    if (binary){
+        if (bin_file(h, db, &files[0]) < 0)
+            goto done;
+    }
+    else if (xmldb_db2file(h, db, &files[0]) < 0)
+        goto done;
+    if (journal && journal_file(h, db, &files[1]) < 0)
+        goto done;
+    cprintf(cb, "%s\n", journal?"journal":binary?"binary":"xml");
+    for (i=0; i<2; i++){
+        if (files[i] == NULL)
+            continue;
+        if (stat(files[i], &st) < 0)
+            cprintf(cb, "none\n");
+        else
+            cprintf(cb, "%ju %jd %ld.%09ld\n",
+                    (uintmax_t)st.st_ino, (intmax_t)st.st_size,
+                    (long)st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+    }
+    retval = 0;
+ done:
+    for (i=0; i<2; i++)
+        if (files[i])
+            free(files[i]);
+    return retval;
+}
+
+/*! Write a db as one XML file per top-level module
+ *
+ * @param[in]  h      Clixon handle
+ * @param[in]  db     Database name
+ * @param[in]  xt     Datastore tree
+ */
+static int
+split_write(clixon_handle h,
+            char         *db,
+            cxobj        *xt)
+{
+    int            retval = -1;
+    char          *dir = NULL;
+    cbuf          *cb = NULL;
+    struct dirent *dp = NULL;
+    int            ndp;
+    FILE          *fp = NULL;
+    cxobj         *xc;
+    cxobj         *xc1;
+    yang_stmt     *ymod;
+    char          *modname;
+    int            i;
+
+    if (db_sidefile(h, db, ".d", &dir) < 0)
+        goto done;
+    if ((cb = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    if (mkdir(dir, 0700) < 0 && errno != EEXIST){
+        clixon_err(OE_UNIX, errno, "mkdir(%s)", dir);
+        goto done;
+    }
+    /* Remove old module files */
+    if ((ndp = clicon_file_dirent(dir, &dp, "\\.xml$", S_IFREG)) < 0)
+        goto done;
+    for (i=0; i<ndp; i++){
+        cbuf_reset(cb);
+        cprintf(cb, "%s/%s", dir, dp[i].d_name);
+        unlink(cbuf_get(cb));
+    }
+    /* Write children of each module to its file, in one pass per module */
+    xc = NULL;
+    while ((xc = xml_child_each(xt, xc, CX_ELMNT)) != NULL){
+        if (xml_flag(xc, XML_FLAG_MARK))
+            continue;
+        if (xml_spec(xc) == NULL || (ymod = ys_module(xml_spec(xc))) == NULL){
+            clixon_err(OE_YANG, 0, "No yang module for %s", xml_name(xc));
+            goto done;
+        }
+        modname = yang_argument_get(ymod);
+        cbuf_reset(cb);
+        cprintf(cb, "%s/%s.xml", dir, modname);
+        if ((fp = fopen(cbuf_get(cb), "w")) == NULL){
+            clixon_err(OE_UNIX, errno, "fopen(%s)", cbuf_get(cb));
+            goto done;
+        }
+        xc1 = xc;
+        do {
+            if (xml_spec(xc1) && ys_module(xml_spec(xc1)) == ymod){
+                if (clixon_xml2file(fp, xc1, 0, 0, NULL, fprintf, 0, 0) < 0)
+                    goto done;
+                xml_flag_set(xc1, XML_FLAG_MARK);
+            }
+        } while ((xc1 = xml_child_each(xt, xc1, CX_ELMNT)) != NULL);
+        fclose(fp);
+        fp = NULL;
+    }
+    xml_apply(xt, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset, (void*)XML_FLAG_MARK);
+    retval = 0;
+ done:
+    if (fp)
+        fclose(fp);
+    if (dp)
+        free(dp);
+    if (cb)
+        cbuf_free(cb);
+    if (dir)
+        free(dir);
+    return retval;
+}
+
+/*! Write the split store of a db and its stamp
+ *
+ * The stamp is taken before the db is loaded and written last, so a store that is
+ * changed or written concurrently is seen as stale.
+ * @param[in]  h        Clixon handle
+ * @param[in]  db       Database name
+ * @param[in]  yspec    YANG spec
+ * @param[in]  journal  Journal format
+ * @param[in]  binary   Binary format
+ */
+static int
+split_build(clixon_handle h,
+            char         *db,
+            yang_stmt    *yspec,
+            int           journal,
+            int           binary)
+{
+    int    retval = -1;
+    char  *dir = NULL;
+    cbuf  *cb = NULL;
+    cbuf  *cbs = NULL;
+    cxobj *xt = NULL;
+    FILE  *fp = NULL;
+
+    if (db_sidefile(h, db, ".d", &dir) < 0)
+        goto done;
+    if ((cb = cbuf_new()) == NULL || (cbs = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    cprintf(cb, "%s/%s", dir, SPLIT_STAMP);
+    if (unlink(cbuf_get(cb)) < 0 && errno != ENOENT){
+        clixon_err(OE_UNIX, errno, "unlink(%s)", cbuf_get(cb));
+        goto done;
+    }
+    if (split_stamp(h, db, journal, binary, cbs) < 0)
+        goto done;
+    if (datastore_load(h, db, yspec, journal, binary, &xt) < 0)
+        goto done;
+    if (split_write(h, db, xt) < 0)
+        goto done;
+    if ((fp = fopen(cbuf_get(cb), "w")) == NULL){
+        clixon_err(OE_UNIX, errno, "fopen(%s)", cbuf_get(cb));
+        goto done;
+    }
+    if (fputs(cbuf_get(cbs), fp) == EOF || fclose(fp) != 0){
+        fp = NULL;
+        clixon_err(OE_UNIX, errno, "write(%s)", cbuf_get(cb));
+        goto done;
+    }
+    fp = NULL;
+    retval = 0;
+ done:
+    if (fp)
+        fclose(fp);
+    if (xt)
+        xml_free(xt);
+    if (cbs)
+        cbuf_free(cbs);
+    if (cb)
+        cbuf_free(cb);
+    if (dir)
+        free(dir);
+    return retval;
+}
+
+/*! Check if the split store of a db is current, ie its stamp matches the source files
+ *
+ * @param[in]  h        Clixon handle
+ * @param[in]  db       Database name
+ * @param[in]  dir      Split store directory
+ * @param[in]  journal  Journal format
+ * @param[in]  binary   Binary format
+ * @retval     1        Current
+ * @retval     0        Stale or missing
+ * @retval    -1        Error
+ */
+static int
+split_current(clixon_handle h,
+              char         *db,
+              char         *dir,
+              int           journal,
+              int           binary)
+{
+    int    retval = -1;
+    cbuf  *cb = NULL;
+    cbuf  *cbs = NULL;
+    FILE  *fp = NULL;
+    char   buf[256];
+    size_t len;
+
+    if ((cb = cbuf_new()) == NULL || (cbs = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    if (split_stamp(h, db, journal, binary, cbs) < 0)
+        goto done;
+    cprintf(cb, "%s/%s", dir, SPLIT_STAMP);
+    retval = 0;
+    if ((fp = fopen(cbuf_get(cb), "r")) == NULL)
+        goto done;
+    len = fread(buf, 1, sizeof(buf)-1, fp);
+    buf[len] = '\0';
+    retval = strcmp(buf, cbuf_get(cbs)) == 0;
+ done:
+    if (fp)
+        fclose(fp);
+    if (cbs)
+        cbuf_free(cbs);
+    if (cb)
+        cbuf_free(cb);
+    return retval;
+}
+
+/*! Check if the first step of an xpath may select top-level data of a module
+ *
+ * @param[in]  ymod    YANG module
+ * @param[in]  prefix  Prefix of first xpath step, or NULL
+ * @param[in]  name    Name of first xpath step, or NULL for any
+ */
+static int
+split_module_match(yang_stmt *ymod,
+                   char      *prefix,
+                   char      *name)
+{
+    char *myprefix;
+
+    if (name == NULL)
+        return 1;
+    if (prefix &&
+        strcmp(prefix, yang_argument_get(ymod)) != 0 &&
+        ((myprefix = yang_find_myprefix(ymod)) == NULL || strcmp(prefix, myprefix) != 0))
+        return 0;
+    return yang_find_datanode(ymod, name) != NULL;
+}
+
+/*! Get from a split db, loading only module files an xpath may touch
+ *
+ * A stale split store is rebuilt first, outside of the measured time.
+ * Prints loaded and total bytes and elapsed time after the result
+ * @param[in]  h        Clixon handle
+ * @param[in]  db       Database name
+ * @param[in]  yspec    YANG spec
+ * @param[in]  journal  Journal format
+ * @param[in]  binary   Binary format
+ * @param[in]  xpath    XPath
+ */
+static int
+split_get(clixon_handle h,
+          char         *db,
+          yang_stmt    *yspec,
+          int           journal,
+          int           binary,
+          char         *xpath)
+{
+    int            retval = -1;
+    char          *dir = NULL;
+    char          *prefix = NULL;
+    char          *name = NULL;
+    cbuf          *cb = NULL;
+    struct dirent *dp = NULL;
+    int            ndp;
+    FILE          *fp = NULL;
+    cxobj         *xt = NULL;
+    cxobj         *xerr = NULL;
+    yang_stmt     *ymod;
+    struct stat    st;
+    struct timeval t0;
+    struct timeval t1;
+    struct timeval td;
+    char          *modname;
+    uint64_t       loaded = 0;
+    uint64_t       total = 0;
+    int            nloaded = 0;
+    int            i;
+    int            ret;
+
+    if (db_sidefile(h, db, ".d", &dir) < 0)
+        goto done;
+    if ((ret = split_current(h, db, dir, journal, binary)) < 0)
+        goto done;
+    if (ret == 0){
+        fprintf(stderr, "split store of %s is stale, rebuilding\n", db);
+        if (split_build(h, db, yspec, journal, binary) < 0)
+            goto done;
+    }
+    gettimeofday(&t0, NULL);
+    if (xpath_top_step(xpath, &prefix, &name) < 0)
+        goto done;
+    if ((cb = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    if ((ndp = clicon_file_dirent(dir, &dp, "\\.xml$", S_IFREG)) < 0)
+        goto done;
+    if ((xt = xml_new(NETCONF_INPUT_CONFIG, NULL, CX_ELMNT)) == NULL)
+        goto done;
+    for (i=0; i<ndp; i++){
+        cbuf_reset(cb);
+        cprintf(cb, "%s/%s", dir, dp[i].d_name);
+        if (stat(cbuf_get(cb), &st) < 0)
+            continue;
+        total += st.st_size;
+        /* Module name is file name without .xml */
+        modname = dp[i].d_name;
+        modname[strlen(modname)-4] = '\0';
+        ymod = NULL;
+        while ((ymod = yn_each(yspec, ymod)) != NULL)
+            if (yang_keyword_get(ymod) == Y_MODULE &&
+                strcmp(yang_argument_get(ymod), modname) == 0)
+                break;
+        if (ymod != NULL && !split_module_match(ymod, prefix, name))
+            continue;
+        if ((fp = fopen(cbuf_get(cb), "r")) == NULL){
+            clixon_err(OE_UNIX, errno, "fopen(%s)", cbuf_get(cb));
+            goto done;
+        }
+        if ((ret = clixon_xml_parse_file(fp, YB_MODULE, yspec, &xt, &xerr)) < 0)
+            goto done;
+        if (ret == 0){
+            clixon_err_netconf(h, OE_XML, 0, xerr, "%s", cbuf_get(cb));
+            goto done;
+        }
+        fclose(fp);
+        fp = NULL;
+        loaded += st.st_size;
+        nloaded++;
+    }
+    if (xml_sort(xt) < 0)
+        goto done;
+    if (xml_filter_xpath(xt, xpath) < 0)
+        goto done;
+    gettimeofday(&t1, NULL);
+    timersub(&t1, &t0, &td);
+    if (clixon_xml2file(stdout, xt, 0, 0, NULL, fprintf, 0, 0) < 0)
+        goto done;
+    fprintf(stdout, "\n");
+    fprintf(stdout, "loaded: %d/%d modules %" PRIu64 "/%" PRIu64 " bytes time: %" PRIu64 " usec\n",
+            nloaded, ndp, loaded, total, timeval2usec(&td));
+    retval = 0;
+ done:
+    if (fp)
+        fclose(fp);
+    if (xerr)
+        xml_free(xerr);
+    if (xt)
+        xml_free(xt);
+    if (dp)
+        free(dp);
+    if (cb)
+        cbuf_free(cb);
+    if (name)
+        free(name);
+    if (prefix)
+        free(prefix);
+    if (dir)
+        free(dir);
+    return retval;
+}
+
+/*
+ * Snapshot isolation
+ * Readers pin an immutable version of the tree while a single writer builds the next
+ * version and publishes it with an atomic pointer swap. Replaced versions are retired
+ * and reclaimed with epoch-based reclamation: a reader announces the global epoch before
+ * it loads the current version, and a version retired at epoch e is freed only when no
+ * reader has announced an epoch <= e.
+ * cxobj trees have parent pointers, so versions cannot share subtrees: the writer copies
+ * the tree. Readers only traverse trees and do not call any other clixon functions.
+ */
+
+/*! An immutable version of the datastore tree
+ */
+struct snap_version {
+    struct snap_version *sv_next;    /* Next in retired list */
+    cxobj               *sv_xt;      /* Tree, read-only once published */
+    uint64_t             sv_retired; /* Epoch when retired */
+};
+
+struct snap_ctx;
+
+/*! Reader thread state
+ */
+struct snap_reader {
+    struct snap_ctx  *sr_ctx;
+    pthread_t         sr_thread;
+    _Atomic uint64_t  sr_epoch;  /* Announced epoch, 0 if not reading */
+    struct bench_stat sr_stat;   /* Read latencies, owned by reader thread */
+    uint64_t          sr_nodes;  /* Nodes visited */
+    int               sr_err;
+};
+
+/*! Shared snapshot state
+ */
+struct snap_ctx {
+    _Atomic(struct snap_version *) sc_current;  /* Current published version */
+    _Atomic uint64_t     sc_epoch;     /* Global epoch, starts at 1 */
+    _Atomic int          sc_stop;      /* Stop readers */
+    struct snap_reader  *sc_readers;
+    int                  sc_nreaders;
+    struct snap_version *sc_retired;   /* Retired, not yet reclaimed versions (writer only) */
+    int                  sc_nretired;
+    int                  sc_published;
+    int                  sc_reclaimed;
+    int                  sc_maxretired;
+};
+
+/*! Read-only traversal of a tree, count nodes
+ *
+ * Uses xml_child_i since xml_child_each caches its position in the child nodes,
+ * ie it writes to the shared tree.
+ */
+static uint64_t
+snap_walk(cxobj *x)
+{
+    uint64_t n = 1;
+    cxobj   *xc;
+    int      i;
+
+    for (i=0; i<xml_child_nr(x); i++)
+        if ((xc = xml_child_i(x, i)) != NULL && xml_type(xc) == CX_ELMNT)
+            n += snap_walk(xc);
+    return n;
+}
+
+/*! Reader thread: repeatedly pin current version, traverse it, and unpin
+ */
+static void *
+snap_reader_thread(void *arg)
+{
+    struct snap_reader  *sr = (struct snap_reader *)arg;
+    struct snap_ctx     *sc = sr->sr_ctx;
+    struct snap_version *sv;
+    struct timeval       t0;
+    struct timeval       t1;
+    struct timeval       td;
+
+    while (!atomic_load(&sc->sc_stop)){
+        gettimeofday(&t0, NULL);
+        atomic_store(&sr->sr_epoch, atomic_load(&sc->sc_epoch));
+        sv = atomic_load(&sc->sc_current);
+        sr->sr_nodes += snap_walk(sv->sv_xt);
+        atomic_store(&sr->sr_epoch, 0);
+        gettimeofday(&t1, NULL);
+        timersub(&t1, &t0, &td);
+        if (bench_stat_add(&sr->sr_stat, timeval2usec(&td)) < 0){
+            sr->sr_err = 1;
+            break;
+        }
+    }
+    return NULL;
+}
+
+static void
+snap_version_free(struct snap_version *sv)
+{
+    if (sv->sv_xt)
+        xml_free(sv->sv_xt);
+    free(sv);
+}
+
+/*! Free retired versions that no reader can still see
+ */
+static void
+snap_reclaim(struct snap_ctx *sc)
+{
+    struct snap_version **svp;
+    struct snap_version  *sv;
+    uint64_t              min = UINT64_MAX;
+    uint64_t              e;
+    int                   i;
+
+    for (i=0; i<sc->sc_nreaders; i++)
+        if ((e = atomic_load(&sc->sc_readers[i].sr_epoch)) != 0 && e < min)
+            min = e;
+    svp = &sc->sc_retired;
+    while ((sv = *svp) != NULL){
+        if (sv->sv_retired < min){
+            *svp = sv->sv_next;
+            snap_version_free(sv);
+            sc->sc_nretired--;
+            sc->sc_reclaimed++;
+        }
+        else
+            svp = &sv->sv_next;
+    }
+}
+
+/*! Writer: build a new version with edit applied and publish it
+ */
+static int
+snap_write(struct snap_ctx *sc,
+           cxobj           *xput,
+           yang_stmt       *yspec)
+{
+    int                  retval = -1;
+    struct snap_version *sv = NULL;
+    struct snap_version *sv0;
+
+    if ((sv = calloc(1, sizeof(*sv))) == NULL){
+        clixon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    sv0 = atomic_load(&sc->sc_current);
+    if ((sv->sv_xt = xml_dup(sv0->sv_xt)) == NULL)
+        goto done;
+    if (datastore_apply(sv->sv_xt, OP_MERGE, xput, yspec, 1) < 0)
+        goto done;
+    atomic_store(&sc->sc_current, sv);
+    sv = NULL;
+    sv0->sv_retired = atomic_fetch_add(&sc->sc_epoch, 1);
+    sv0->sv_next = sc->sc_retired;
+    sc->sc_retired = sv0;
+    sc->sc_published++;
+    if (++sc->sc_nretired > sc->sc_maxretired)
+        sc->sc_maxretired = sc->sc_nretired;
+    snap_reclaim(sc);
+    retval = 0;
+ done:
+    if (sv)
+        snap_version_free(sv);
+    return retval;
+}
+
+/*! Stress snapshot isolation: N reader threads and one writer for a number of seconds
+ *
+ * The writer merges the XML in xmlfilename into a new version as fast as it can.
+ * Prints reader latency under write load, and versions published and reclaimed.
+ * @param[in]  xt          Initial datastore tree, consumed
+ * @param[in]  yspec       YANG spec
+ * @param[in]  xmlfilename XML payload of writes
+ * @param[in]  nreaders    Number of reader threads
+ * @param[in]  seconds     Duration
+ */
+static int
+snap_stress(cxobj     *xt,
+            yang_stmt *yspec,
+            char      *xmlfilename,
+            int        nreaders,
+            int        seconds)
+{
+    int                  retval = -1;
+    struct snap_ctx      sc = {0,};
+    struct snap_version *sv;
+    struct bench_stat    bs = {"read",};
+    cxobj               *xput = NULL;
+    struct timeval       t0;
+    struct timeval       t1;
+    uint64_t             nodes = 0;
+    int                  started = 0;
+    int                  i;
+    int                  j;
+
+    if (xmlfilename == NULL){
+        clixon_err(OE_DB, 0, "stress requires -x <xml>");
+        goto done;
+    }
+    if (nreaders < 1){
+        clixon_err(OE_DB, 0, "stress requires at least one reader");
+        goto done;
+    }
+    if (datastore_xml_file(xmlfilename, yspec, &xput) < 0)
+        goto done;
+    if ((sv = calloc(1, sizeof(*sv))) == NULL){
+        clixon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    sv->sv_xt = xt;
+    xt = NULL;
+    atomic_store(&sc.sc_current, sv);
+    atomic_store(&sc.sc_epoch, 1);
+    if ((sc.sc_readers = calloc(nreaders, sizeof(struct snap_reader))) == NULL){
+        clixon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    sc.sc_nreaders = nreaders;
+    for (i=0; i<nreaders; i++){
+        sc.sc_readers[i].sr_ctx = &sc;
+        sc.sc_readers[i].sr_stat.bs_name = "read";
+        if ((errno = pthread_create(&sc.sc_readers[i].sr_thread, NULL,
+                                    snap_reader_thread, &sc.sc_readers[i])) != 0){
+            clixon_err(OE_UNIX, errno, "pthread_create");
+            goto done;
+        }
+        started++;
+    }
+    gettimeofday(&t0, NULL);
+    do {
+        if (snap_write(&sc, xput, yspec) < 0)
+            goto done;
+        gettimeofday(&t1, NULL);
+    } while (t1.tv_sec - t0.tv_sec < seconds);
+    retval = 0;
+ done:
+    atomic_store(&sc.sc_stop, 1);
+    for (i=0; i<started; i++)
+        pthread_join(sc.sc_readers[i].sr_thread, NULL);
+    if (retval == 0){
+        for (i=0; i<started; i++){
+            struct snap_reader *sr = &sc.sc_readers[i];
+            if (sr->sr_err)
+                retval = -1;
+            nodes += sr->sr_nodes;
+            for (j=0; j<sr->sr_stat.bs_len; j++)
+                if (bench_stat_add(&bs, sr->sr_stat.bs_vec[j]) < 0)
+                    retval = -1;
+        }
+        fprintf(stdout, "readers: %d seconds: %d reads: %d nodes read: %" PRIu64 "\n",
+                nreaders, seconds, bs.bs_len, nodes);
+        bench_stat_print(stdout, &bs);
+        fprintf(stdout, "writer: versions published: %d reclaimed: %d max retired: %d\n",
+                sc.sc_published, sc.sc_reclaimed, sc.sc_maxretired);
+    }
+    if (sc.sc_readers){
+        for (i=0; i<nreaders; i++)
+            if (sc.sc_readers[i].sr_stat.bs_vec)
+                free(sc.sc_readers[i].sr_stat.bs_vec);
+        free(sc.sc_readers);
+    }
+    while ((sv = sc.sc_retired) != NULL){
+        sc.sc_retired = sv->sv_next;
+        snap_version_free(sv);
+    }
+    if ((sv = atomic_load(&sc.sc_current)) != NULL)
+        snap_version_free(sv);
+    if (bs.bs_vec)
+        free(bs.bs_vec);
+    if (xput)
+        xml_free(xput);
+    if (xt)
+        xml_free(xt);
+    return retval;
+}
+
+/*
+ * Durability levels of put (-S)
+ * xmldb_put writes the db file but leaves it to the kernel when it reaches disk.
+ * sync:  fsync after each put, nothing is lost on a crash once put returns
+ * group: fsync at most once per window (-W), coalescing the puts made meanwhile
+ * async: puts are queued to a background writer thread that writes and fsyncs
+ *        whatever is queued in one go. The caller only waits for the enqueue.
+ * The data-loss window is the time from a put returning until it is synced.
+ * Grouping needs several puts in one process, as in wbench. The put command makes a
+ * single put, so there group is the same as sync, and async leaves the sync to
+ * kernel writeback.
+ */
+enum ds_durability {
+    DS_SYNC,
+    DS_GROUP,
+    DS_ASYNC
+};
+
+/*! Get the max time until the kernel writes back a dirty page, in usecs, 0 if unknown
+ *
+ * A page is written back when it is older than the dirty expire time, which the
+ * flusher checks once per writeback interval.
+ */
+static uint64_t
+ds_writeback_usec(void)
+{
+    const char *files[] = {"/proc/sys/vm/dirty_expire_centisecs",
+                           "/proc/sys/vm/dirty_writeback_centisecs"};
+    FILE       *f;
+    uint64_t    usec = 0;
+    unsigned    cs;
+    int         i;
+
+    for (i=0; i<2; i++){
+        if ((f = fopen(files[i], "r")) == NULL)
+            return 0;
+        if (fscanf(f, "%u", &cs) != 1)
+            cs = 0;
+        fclose(f);
+        if (cs == 0)
+            return 0;
+        usec += (uint64_t)cs*10000;
+    }
+    return usec;
+}
+
+/*! Queued put request for the async writer
+ */
+struct wb_req {
+    struct wb_req  *wr_next;
+    struct timeval  wr_t;      /* Time enqueued */
+};
+
+/*! Write-behind queue of the async writer thread
+ *
+ * The writer thread is the only user of libclixon while it runs, the caller only
+ * enqueues requests. Each request puts a copy of the same payload wq_xt.
+ */
+struct wb_queue {
+    pthread_mutex_t wq_mutex;
+    pthread_cond_t  wq_cond;
+    struct wb_req  *wq_head;
+    struct wb_req  *wq_tail;
+    int             wq_done;    /* No more requests */
+    clixon_handle   wq_h;
+    char           *wq_db;
+    cxobj          *wq_xt;      /* Put payload, read-only */
+    int             wq_err;
+    int             wq_fsyncs;
+    uint64_t        wq_maxloss; /* Max usecs from enqueue to synced */
+};
+
+/*! Put a copy of the payload with merge, payload top is renamed to config
+ */
+static int
+wb_put(clixon_handle h,
+       char         *db,
+       cxobj        *xt,
+       cbuf         *cbret)
+{
+    cxobj *x1;
+    int    ret;
+
+    if ((x1 = xml_dup(xt)) == NULL)
+        return -1;
+    cbuf_reset(cbret);
+    ret = trace_put(h, db, OP_MERGE, x1, NULL, cbret);
+    xml_free(x1);
+    if (ret < 0)
+        return -1;
+    if (ret == 0){
+        clixon_err(OE_DB, 0, "put: %s", cbuf_get(cbret));
+        return -1;
+    }
+    return 0;
+}
+
+/*! Async writer thread, write and sync queued puts in batches
+ */
+static void *
+wb_writer_thread(void *arg)
+{
+    struct wb_queue *wq = (struct wb_queue *)arg;
+    struct wb_req   *batch;
+    struct wb_req   *wr;
+    struct timeval   t1;
+    struct timeval   td;
+    cbuf            *cbret = NULL;
+
+    if ((cbret = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        wq->wq_err = 1;
+    }
+    while (1){
+        pthread_mutex_lock(&wq->wq_mutex);
+        while (wq->wq_head == NULL && !wq->wq_done)
+            pthread_cond_wait(&wq->wq_cond, &wq->wq_mutex);
+        batch = wq->wq_head;
+        wq->wq_head = wq->wq_tail = NULL;
+        pthread_mutex_unlock(&wq->wq_mutex);
+        if (batch == NULL)
+            break;
+        for (wr = batch; wr && !wq->wq_err; wr = wr->wr_next)
+            if (wb_put(wq->wq_h, wq->wq_db, wq->wq_xt, cbret) < 0)
+                wq->wq_err = 1;
+        if (!wq->wq_err){
+            if (db_fsync(wq->wq_h, wq->wq_db) < 0)
+                wq->wq_err = 1;
+            wq->wq_fsyncs++;
+        }
+        gettimeofday(&t1, NULL);
+        timersub(&t1, &batch->wr_t, &td); /* Oldest request of batch */
+        if (timeval2usec(&td) > wq->wq_maxloss)
+            wq->wq_maxloss = timeval2usec(&td);
+        while ((wr = batch) != NULL){
+            batch = wr->wr_next;
+            free(wr);
+        }
+    }
+    if (cbret)
+        cbuf_free(cbret);
+    return NULL;
+}
+
+/*! Measure put throughput and data-loss window of a durability level
+ *
+ * Makes nr merge puts of the payload in xmlfilename and syncs all of them before
+ * returning.
+ * @param[in]  h           Clixon handle
+ * @param[in]  db          Database name
+ * @param[in]  yspec       YANG spec
+ * @param[in]  xmlfilename Put payload
+ * @param[in]  nr          Number of puts
+ * @param[in]  dur         Durability level
+ * @param[in]  window      Group commit window in usecs
+ */
+static int
+datastore_wbench(clixon_handle       h,
+                 char               *db,
+                 yang_stmt          *yspec,
+                 char               *xmlfilename,
+                 int                 nr,
+                 enum ds_durability  dur,
+                 uint64_t            window)
+{
+    int               retval = -1;
+    cxobj            *xt = NULL;
+    cbuf             *cbret = NULL;
+    struct bench_stat bs = {"put", NULL, 0};
+    struct wb_queue   wq;
+    struct wb_req    *wr;
+    pthread_t         tid;
+    int               started = 0;
+    struct timeval    t0;
+    struct timeval    t1;
+    struct timeval    tp;
+    struct timeval    tsync;    /* Last sync */
+    struct timeval    tunsync;  /* First put after last sync */
+    struct timeval    td;
+    int               unsynced = 0;
+    int               fsyncs = 0;
+    uint64_t          maxloss = 0;
+    uint64_t          total;
+    int               i;
+
+    memset(&wq, 0, sizeof(wq));
+    pthread_mutex_init(&wq.wq_mutex, NULL);
+    pthread_cond_init(&wq.wq_cond, NULL);
+    if (datastore_xml_file(xmlfilename, yspec, &xt) < 0)
+        goto done;
+    if ((cbret = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    if (dur == DS_ASYNC){
+        wq.wq_h = h;
+        wq.wq_db = db;
+        wq.wq_xt = xt;
+        if ((errno = pthread_create(&tid, NULL, wb_writer_thread, &wq)) != 0){
+            clixon_err(OE_UNIX, errno, "pthread_create");
+            goto done;
+        }
+        started++;
+    }
+    gettimeofday(&t0, NULL);
+    tsync = t0;
+    for (i=0; i<nr; i++){
+        gettimeofday(&tp, NULL);
+        switch (dur){
+        case DS_SYNC:
+            if (wb_put(h, db, xt, cbret) < 0)
+                goto done;
+            if (db_fsync(h, db) < 0)
+                goto done;
+            fsyncs++;
+            break;
+        case DS_GROUP:
+            if (wb_put(h, db, xt, cbret) < 0)
+                goto done;
+            gettimeofday(&t1, NULL);
+            if (!unsynced++)
+                tunsync = t1;
+            timersub(&t1, &tsync, &td);
+            if (timeval2usec(&td) >= window){
+                if (db_fsync(h, db) < 0)
+                    goto done;
+                fsyncs++;
+                gettimeofday(&tsync, NULL);
+                timersub(&tsync, &tunsync, &td);
+                if (timeval2usec(&td) > maxloss)
+                    maxloss = timeval2usec(&td);
+                unsynced = 0;
+            }
+            break;
+        case DS_ASYNC:
+            if ((wr = calloc(1, sizeof(*wr))) == NULL){
+                clixon_err(OE_UNIX, errno, "calloc");
+                goto done;
+            }
+            wr->wr_t = tp;
+            pthread_mutex_lock(&wq.wq_mutex);
+            if (wq.wq_tail)
+                wq.wq_tail->wr_next = wr;
+            else
+                wq.wq_head = wr;
+            wq.wq_tail = wr;
+            pthread_cond_signal(&wq.wq_cond);
+            pthread_mutex_unlock(&wq.wq_mutex);
+            break;
+        }
+        gettimeofday(&t1, NULL);
+        timersub(&t1, &tp, &td);
+        if (bench_stat_add(&bs, timeval2usec(&td)) < 0)
+            goto done;
+    }
+    /* Drain: everything is synced when done */
+    if (dur == DS_GROUP && unsynced){
+        if (db_fsync(h, db) < 0)
+            goto done;
+        fsyncs++;
+        gettimeofday(&tsync, NULL);
+        timersub(&tsync, &tunsync, &td);
+        if (timeval2usec(&td) > maxloss)
+            maxloss = timeval2usec(&td);
+    }
+    if (dur == DS_ASYNC){
+        pthread_mutex_lock(&wq.wq_mutex);
+        wq.wq_done = 1;
+        pthread_cond_signal(&wq.wq_cond);
+        pthread_mutex_unlock(&wq.wq_mutex);
+        pthread_join(tid, NULL);
+        started = 0;
+        if (wq.wq_err)
+            goto done;
+        fsyncs = wq.wq_fsyncs;
+        maxloss = wq.wq_maxloss;
+    }
+    gettimeofday(&t1, NULL);
+    timersub(&t1, &t0, &td);
+    total = timeval2usec(&td);
+    fprintf(stdout, "%s: puts: %d fsyncs: %d time: %lu.%06lu throughput: %.0f puts/s loss window: %" PRIu64 " usec\n",
+            dur==DS_SYNC?"sync":dur==DS_GROUP?"group":"async",
+            nr, fsyncs, td.tv_sec, td.tv_usec,
+            total ? (double)nr*1000000/total : 0.0,
+            maxloss);
+    bench_stat_print(stdout, &bs);
+    retval = 0;
+ done:
+    if (started){
+        pthread_mutex_lock(&wq.wq_mutex);
+        wq.wq_done = 1;
+        pthread_cond_signal(&wq.wq_cond);
+        pthread_mutex_unlock(&wq.wq_mutex);
+        pthread_join(tid, NULL);
+    }
+    pthread_mutex_destroy(&wq.wq_mutex);
+    pthread_cond_destroy(&wq.wq_cond);
+    if (bs.bs_vec)
+        free(bs.bs_vec);
+    if (cbret)
+        cbuf_free(cbret);
+    if (xt)
+        xml_free(xt);
+    return retval;
+}
+
+/*
+ * Fast datastore copy
+ * A copy clones the db file: by reflink (FICLONE) where the filesystem supports it,
+ * which shares data blocks until either file is written, otherwise by
+ * copy_file_range, which copies in the kernel, and read/write as last resort.
+ * The cache of the target db is cleared and loaded from the file on first access.
+ * The cached trees themselves cannot be shared: cxobj nodes have parent pointers
+ * and xmldb_put modifies the cached tree in place.
+ */
+
+/*! Clone a file via a temporary file and rename
+ *
+ * @param[in]  from    Source file
+ * @param[in]  to      Target file
+ * @param[out] method  How it was copied: reflink, copy_file_range or read/write
+ */
+static int
+file_clone(char        *from,
+           char        *to,
+           const char **method)
+{
+    int         retval = -1;
+    int         fd0 = -1;
+    int         fd1 = -1;
+    struct stat st;
+    cbuf       *cb = NULL;
+    char        buf[65536];
+    ssize_t     n;
+    off_t       left;
+
+    if ((cb = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    cprintf(cb, "%s.tmp", to);
+    if ((fd0 = open(from, O_RDONLY)) < 0){
+        clixon_err(OE_UNIX, errno, "open(%s)", from);
+        goto done;
+    }
+    if (fstat(fd0, &st) < 0){
+        clixon_err(OE_UNIX, errno, "fstat(%s)", from);
+        goto done;
+    }
+    if ((fd1 = open(cbuf_get(cb), O_WRONLY|O_CREAT|O_TRUNC, st.st_mode & 0777)) < 0){
+        clixon_err(OE_UNIX, errno, "open(%s)", cbuf_get(cb));
+        goto done;
+    }
+    *method = "read/write";
+#ifdef FICLONE
+    if (ioctl(fd1, FICLONE, fd0) == 0){
+        *method = "reflink";
+        goto ok;
+    }
+#endif
+    left = st.st_size;
+#ifdef SYS_copy_file_range
+    /* Advances both file offsets, read/write continues where it stops */
+    while (left > 0 &&
+           (n = syscall(SYS_copy_file_range, fd0, NULL, fd1, NULL, (size_t)left, 0)) > 0)
+        left -= n;
+    if (left == 0){
+        *method = "copy_file_range";
+        goto ok;
+    }
+#endif
+    while ((n = read(fd0, buf, sizeof(buf))) != 0){
+        if (n < 0){
+            clixon_err(OE_UNIX, errno, "read(%s)", from);
+            goto done;
+        }
+        if (write(fd1, buf, n) != n){
+            clixon_err(OE_UNIX, errno, "write(%s)", cbuf_get(cb));
+            goto done;
+        }
+    }
+ ok:
+    if (close(fd1) < 0){
+        fd1 = -1;
+        clixon_err(OE_UNIX, errno, "close(%s)", cbuf_get(cb));
+        goto done;
+    }
+    fd1 = -1;
+    if (rename(cbuf_get(cb), to) < 0){
+        clixon_err(OE_UNIX, errno, "rename(%s)", to);
+        goto done;
+    }
+    retval = 0;
+ done:
+    if (fd1 != -1){
+        close(fd1);
+        unlink(cbuf_get(cb));
+    }
+    if (fd0 != -1)
+        close(fd0);
+    if (cb)
+        cbuf_free(cb);
+    return retval;
+}
+
+/*! Copy a db by cloning its file, fall back to xmldb_copy if it has no file
+ *
+ * A valid hash file of the source is carried over to the target.
+ * @param[in]  h       Clixon handle
+ * @param[in]  from    Source database
+ * @param[in]  to      Target database
+ * @param[out] method  How it was copied
+ */
+static int
+datastore_copy(clixon_handle h,
+               char         *from,
+               char         *to,
+               const char  **method)
+{
+    int             retval = -1;
+    char           *fromfile = NULL;
+    char           *tofile = NULL;
+    struct stat     st;
+    struct ds_stamp stamp;
+    uint64_t        hash;
+    cbuf           *cbsub = NULL;
+    struct timeval  t0;
+    struct timeval  t1;
+    int             ret;
+
+    gettimeofday(&t0, NULL);
+    if (xmldb_db2file(h, from, &fromfile) < 0)
+        goto done;
+    if (xmldb_db2file(h, to, &tofile) < 0)
+        goto done;
+    if (stat(fromfile, &st) < 0){
+        *method = "xmldb_copy";
+        if (xmldb_copy(h, from, to) < 0)
+            goto done;
+        goto ok;
+    }
+    if (file_clone(fromfile, tofile, method) < 0)
+        goto done;
+    if (xmldb_clear(h, to) < 0)
+        goto done;
+    if ((cbsub = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    if ((ret = hash_read(h, from, &hash, cbsub)) < 0)
+        goto done;
+    if (ret == 1){
+        if (ds_stamp_get(h, to, &stamp) < 0)
+            goto done;
+        if (hash_store(h, to, &stamp, hash, cbsub) < 0)
+            goto done;
+    }
+ ok:
+    gettimeofday(&t1, NULL);
+    if (_trace_f && trace_record(TRACE_COPY,
+                                 strcmp(*method, "xmldb_copy") == 0 ? TRACE_COPY_XMLDB : TRACE_COPY_CLONE,
+                                 0, &t0, &t1, from, to) < 0)
+        goto done;
+    retval = 0;
+ done:
+    if (cbsub)
+        cbuf_free(cbsub);
+    if (tofile)
+        free(tofile);
+    if (fromfile)
+        free(fromfile);
+    return retval;
+}
+
+/*! Compare fast copy with xmldb_copy, including the first get of the copy
+ *
+ * @param[in]  h     Clixon handle
+ * @param[in]  db    Source database
+ * @param[in]  todb  Target database
+ * @param[in]  nr    Number of copies of each kind
+ */
+static int
+datastore_copybench(clixon_handle h,
+                    char         *db,
+                    char         *todb,
+                    int           nr)
+{
+    int               retval = -1;
+    struct bench_stat bscopy = {"copy", NULL, 0};
+    struct bench_stat bsget = {"get", NULL, 0};
+    const char       *method = NULL;
+    struct timeval    t0;
+    struct timeval    t1;
+    struct timeval    td;
+    cxobj            *xt = NULL;
+    int               fast;
+    int               i;
+
+    for (fast=0; fast<2; fast++){
+        for (i=0; i<nr; i++){
+            gettimeofday(&t0, NULL);
+            if (fast){
+                if (datastore_copy(h, db, todb, &method) < 0)
+                    goto done;
+            }
+            else {
+                method = "xmldb_copy";
+                if (trace_copy(h, db, todb) < 0)
+                    goto done;
+            }
+            gettimeofday(&t1, NULL);
+            timersub(&t1, &t0, &td);
+            if (bench_stat_add(&bscopy, timeval2usec(&td)) < 0)
+                goto done;
+            /* First access of the copy, loads it if not cached */
+            gettimeofday(&t0, NULL);
+            if (trace_get(h, todb, NULL, "/", &xt) < 0)
+                goto done;
+            gettimeofday(&t1, NULL);
+            timersub(&t1, &t0, &td);
+            if (bench_stat_add(&bsget, timeval2usec(&td)) < 0)
+                goto done;
+            xml_free(xt);
+            xt = NULL;
+            /* Next copy starts without cached target */
+            if (xmldb_clear(h, todb) < 0)
+                goto done;
+        }
+        fprintf(stdout, "%s:\n", method);
+        bench_stat_print(stdout, &bscopy);
+        bench_stat_print(stdout, &bsget);
+        bscopy.bs_len = 0;
+        bsget.bs_len = 0;
+    }
+    retval = 0;
+ done:
+    if (xt)
+        xml_free(xt);
+    if (bscopy.bs_vec)
+        free(bscopy.bs_vec);
+    if (bsget.bs_vec)
+        free(bsget.bs_vec);
+    return retval;
+}
+
+/*! Replay a trace and compare latencies with the recorded ones
+ *
+ * Calls are issued at their recorded times divided by speed, or back-to-back if
+ * speed is 0. Put payloads are parsed before the call is timed.
+ * @param[in]  h         Clixon handle
+ * @param[in]  yspec     YANG spec
+ * @param[in]  filename  Trace file
+ * @param[in]  speed     Speed factor, 1 is original speed, 0 is as fast as possible
+ */
+static int
+datastore_replay(clixon_handle h,
+                 yang_stmt    *yspec,
+                 char         *filename,
+                 double        speed)
+{
+    int               retval = -1;
+    FILE             *f = NULL;
+    char              magic[4];
+    uint32_t          version;
+    struct trace_rec  tr;
+    char             *payload = NULL;
+    size_t            paylen = 0;
+    char             *db;
+    char             *arg;
+    struct bench_stat bs[TRACE_NR];
+    int64_t           devsum[TRACE_NR] = {0,};
+    uint64_t          devmax[TRACE_NR] = {0,};
+    int               mismatch[TRACE_NR] = {0,};
+    int64_t           dev;
+    uint64_t          lagmax = 0;
+    uint64_t          usec;
+    uint64_t          target;
+    struct timeval    tstart;
+    struct timeval    t0;
+    struct timeval    t1;
+    struct timeval    td;
+    cxobj            *xt = NULL;
+    cxobj            *xerr = NULL;
+    cbuf             *cbret = NULL;
+    const char       *method;
+    int               nr = 0;
+    int               ret;
+    int               i;
+
+    memset(bs, 0, sizeof(bs));
+    for (i=0; i<TRACE_NR; i++)
+        bs[i].bs_name = (char*)trace_op_names[i];
+    if ((cbret = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    if ((f = fopen(filename, "r")) == NULL){
+        clixon_err(OE_UNIX, errno, "fopen(%s)", filename);
+        goto done;
+    }
+    if (fread(magic, sizeof(magic), 1, f) != 1 ||
+        fread(&version, sizeof(version), 1, f) != 1 ||
+        memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0 ||
+        version != TRACE_VERSION){
+        clixon_err(OE_DB, 0, "%s: not a trace file", filename);
+        goto done;
+    }
+    gettimeofday(&tstart, NULL);
+    while (fread(&tr, sizeof(tr), 1, f) == 1){
+        if (tr.tr_op >= TRACE_NR || tr.tr_len < 2){
+            clixon_err(OE_DB, 0, "%s: corrupt trace record %d", filename, nr);
+            goto done;
+        }
+        if (tr.tr_len > paylen){
+            if ((payload = realloc(payload, tr.tr_len)) == NULL){
+                clixon_err(OE_UNIX, errno, "realloc");
+                goto done;
+            }
+            paylen = tr.tr_len;
+        }
+        if (fread(payload, tr.tr_len, 1, f) != 1 ||
+            payload[tr.tr_len-1] != '\0' ||
+            fnv1a(FNV1A_OFFSET, payload, tr.tr_len) != tr.tr_hash){
+            clixon_err(OE_DB, 0, "%s: corrupt trace record %d", filename, nr);
+            goto done;
+        }
+        db = payload;
+        arg = payload + strlen(db) + 1;
+        if (arg >= payload + tr.tr_len){
+            clixon_err(OE_DB, 0, "%s: corrupt trace record %d", filename, nr);
+            goto done;
+        }
+        if (tr.tr_op == TRACE_PUT){
+            if ((ret = clixon_xml_parse_string(arg, YB_MODULE, yspec, &xt, &xerr)) < 0)
+                goto done;
+            if (ret == 0){
+                clixon_err_netconf(h, OE_XML, 0, xerr, "%s: record %d", filename, nr);
+                goto done;
+            }
+            if (xml_name_set(xt, NETCONF_INPUT_CONFIG) < 0)
+                goto done;
+        }
+        /* Wait until scheduled time */
+        gettimeofday(&t0, NULL);
+        timersub(&t0, &tstart, &td);
+        if (speed > 0){
+            target = (uint64_t)(tr.tr_time / speed);
+            if (timeval2usec(&td) < target){
+                usleep(target - timeval2usec(&td));
+                gettimeofday(&t0, NULL);
+            }
+            else if (timeval2usec(&td) - target > lagmax)
+                lagmax = timeval2usec(&td) - target;
+        }
+        switch (tr.tr_op){
+        case TRACE_GET:
+            ret = xmldb_get(h, db, NULL, arg, &xt);
+            break;
+        case TRACE_PUT:
+            cbuf_reset(cbret);
+            ret = xmldb_put(h, db, tr.tr_edit, xt, NULL, cbret);
+            break;
+        case TRACE_COPY: /* With the recorded primitive */
+            if (tr.tr_edit == TRACE_COPY_CLONE)
+                ret = datastore_copy(h, db, arg, &method);
+            else
+                ret = xmldb_copy(h, db, arg);
+            break;
+        case TRACE_LOCK:
+            ret = xmldb_lock(h, db, strtoul(arg, NULL, 10));
+            break;
+        case TRACE_UNLOCK:
+            ret = xmldb_unlock(h, db);
+            break;
+        case TRACE_UNLOCK_ALL:
+            ret = xmldb_unlock_all(h, strtoul(arg, NULL, 10));
+            break;
+        default:
+            ret = -1;
+            break;
+        }
+        gettimeofday(&t1, NULL);
+        if (xt){
+            xml_free(xt);
+            xt = NULL;
+        }
+        timersub(&t1, &t0, &td);
+        usec = timeval2usec(&td);
+        if (bench_stat_add(&bs[tr.tr_op], usec) < 0)
+            goto done;
+        dev = (int64_t)usec - (int64_t)tr.tr_usec;
+        devsum[tr.tr_op] += dev;
+        if ((uint64_t)(dev<0?-dev:dev) > devmax[tr.tr_op])
+            devmax[tr.tr_op] = dev<0?-dev:dev;
+        if ((ret < 0 ? -1 : ret) != tr.tr_ret)
+            mismatch[tr.tr_op]++;
+        nr++;
+    }
+    gettimeofday(&t1, NULL);
+    timersub(&t1, &tstart, &td);
+    fprintf(stdout, "replay: records: %d time: %lu.%06lu speed: %g max lag: %" PRIu64 " usec\n",
+            nr, td.tv_sec, td.tv_usec, speed, lagmax);
+    for (i=0; i<TRACE_NR; i++){
+        if (bs[i].bs_len == 0)
+            continue;
+        bench_stat_print(stdout, &bs[i]);
+        fprintf(stdout, "%-6s deviation mean: %+" PRId64 " max: %" PRIu64 " usec result mismatches: %d\n",
+                bs[i].bs_name, devsum[i]/bs[i].bs_len, devmax[i], mismatch[i]);
+    }
+    retval = 0;
+ done:
+    for (i=0; i<TRACE_NR; i++)
+        if (bs[i].bs_vec)
+            free(bs[i].bs_vec);
+    if (cbret)
+        cbuf_free(cbret);
+    if (xerr)
+        xml_free(xerr);
+    if (xt)
+        xml_free(xt);
+    if (payload)
+        free(payload);
+    if (f)
+        fclose(f);
+    return retval;
+}
+
+/*
+ * Partial locks (RFC 5717)
+ * An in-process lock manager where a session locks subtrees given by path. Two locks
+ * conflict if they are held by different sessions and one path is a prefix of the
+ * other at a node boundary, eg "/a/b" conflicts with "/a/b/c" and "/a/b[k='1']" but
+ * not with "/a/bc" or "/a/c". "/" conflicts with all paths, ie is a global lock.
+ * Paths are compared as strings, so they are assumed to be canonical.
+ * The lock manager only lives in the plbench process and only measures contention:
+ * the lock commands and put do not use it, since each invocation of this utility is
+ * a separate process without shared lock state.
+ */
+
+/*! A held partial lock
+ */
+struct plock {
+    struct plock *pl_next;
+    char         *pl_path;  /* Locked subtree */
+    uint32_t      pl_id;    /* Session id */
+};
+
+/*! Partial lock manager
+ */
+struct plock_mgr {
+    pthread_mutex_t pm_mutex;
+    pthread_cond_t  pm_cond;    /* Signalled on unlock */
+    struct plock   *pm_list;
+    uint64_t        pm_waits;   /* Number of times a lock request had to wait */
+};
+
+/*! Check if two paths overlap, ie one is a prefix of the other at a node boundary
+ *
+ * A "/" inside a predicate is not a node boundary.
+ */
+static int
+plock_overlap(const char *p0,
+              const char *p1)
+{
+    const char *s;
+    int         brackets = 0;
 
-/* cligen */
-#include <cligen/cligen.h>
+    if (strcmp(p0, "/") == 0 || strcmp(p1, "/") == 0)
+        return 1;
+    for (s = p0; *s && *s == *p1; s++, p1++)
+        if (*s == '[')
+            brackets++;
+        else if (*s == ']')
+            brackets--;
+    if (*s && *p1) /* Differ before end of either */
+        return 0;
+    if (*s == '\0' && *p1 == '\0')
+        return 1;
+    if (brackets)
+        return 0;
+    s = *s ? s : p1; /* Remainder of longer path */
+    return *s == '/' || *s == '[';
+}
 
-/* clicon */
-#include <clixon/clixon.h>
+static int
+plock_init(struct plock_mgr *pm)
+{
+    memset(pm, 0, sizeof(*pm));
+    if (pthread_mutex_init(&pm->pm_mutex, NULL) != 0 ||
+        pthread_cond_init(&pm->pm_cond, NULL) != 0){
+        clixon_err(OE_UNIX, errno, "pthread init");
+        return -1;
+    }
+    return 0;
+}
 
-/* Command line options to be passed to getopt(3) */
-#define DATASTORE_OPTS "hDd:b:f:x:y:Y:"
+static void
+plock_exit(struct plock_mgr *pm)
+{
+    struct plock *pl;
 
-/*! usage
+    while ((pl = pm->pm_list) != NULL){
+        pm->pm_list = pl->pl_next;
+        free(pl->pl_path);
+        free(pl);
+    }
+    pthread_cond_destroy(&pm->pm_cond);
+    pthread_mutex_destroy(&pm->pm_mutex);
+}
+
+/*! Find a lock of another session conflicting with path, caller holds mutex
  */
-static void
-usage(char *argv0)
+static struct plock *
+plock_conflict(struct plock_mgr *pm,
+               const char       *path,
+               uint32_t          id)
 {
-    fprintf(stderr, "usage:%s <options>* [<command>]\n"
-            "where options are\n"
-            "\t-h\t\tHelp\n"
-            "\t-D\t\tDebug\n"
-            "\t-d <db>\t\tDatabase name. Default: running. Alt: candidate,startup\n"
-            "\t-b <dir>\tDatabase directory. Mandatory\n"
-            "\t-f <fmt>\tDatabase format: xml or json\n"
-            "\t-x <xml>\tXML file. Alternative to put <xml> argument\n"
-            "\t-y <file>\tYang file. Mandatory\n"
-            "\t-Y <dir> \tYang dirs (can be several)\n"
-            "and command is either:\n"
-            "\tget [<xpath>]\n"
-            "\tmget <nr> [<xpath>]\n"
-            "\tput (merge|replace|create|delete|remove) [<xml>]\n"
-            "\tcopy <todb>\n"
-            "\tlock <pid>\n"
-            "\tunlock\n"
-            "\tunlock_all <pid>\n"
-            "\tislocked\n"
-            "\texists\n"
-            "\tdelete\n"
-            "\tinit\n"
-            ,
-            argv0
-            );
-    exit(0);
+    struct plock *pl;
+
+    for (pl = pm->pm_list; pl; pl = pl->pl_next)
+        if (pl->pl_id != id && plock_overlap(pl->pl_path, path))
+            return pl;
+    return NULL;
+}
+
+/*! Lock a subtree
+ *
+ * @param[in]  pm    Lock manager
+ * @param[in]  path  Subtree path
+ * @param[in]  id    Session id
+ * @param[in]  wait  If set, wait for conflicting locks to be released
+ * @retval     1     Locked
+ * @retval     0     Conflict, not locked (wait not set)
+ * @retval    -1     Error
+ */
+static int
+plock_lock(struct plock_mgr *pm,
+           const char       *path,
+           uint32_t          id,
+           int               wait)
+{
+    int           retval = -1;
+    struct plock *pl = NULL;
+
+    pthread_mutex_lock(&pm->pm_mutex);
+    if (plock_conflict(pm, path, id) != NULL){
+        if (!wait){
+            retval = 0;
+            goto done;
+        }
+        pm->pm_waits++;
+        while (plock_conflict(pm, path, id) != NULL)
+            pthread_cond_wait(&pm->pm_cond, &pm->pm_mutex);
+    }
+    if ((pl = calloc(1, sizeof(*pl))) == NULL ||
+        (pl->pl_path = strdup(path)) == NULL){
+        clixon_err(OE_UNIX, errno, "calloc");
+        if (pl)
+            free(pl);
+        goto done;
+    }
+    pl->pl_id = id;
+    pl->pl_next = pm->pm_list;
+    pm->pm_list = pl;
+    retval = 1;
+ done:
+    pthread_mutex_unlock(&pm->pm_mutex);
+    return retval;
+}
+
+/*! Unlock a subtree locked by a session, or all its locks if path is NULL
+ *
+ * @retval  n   Number of locks released
+ */
+static int
+plock_unlock(struct plock_mgr *pm,
+             const char       *path,
+             uint32_t          id)
+{
+    struct plock **plp;
+    struct plock  *pl;
+    int            n = 0;
+
+    pthread_mutex_lock(&pm->pm_mutex);
+    plp = &pm->pm_list;
+    while ((pl = *plp) != NULL){
+        if (pl->pl_id == id && (path == NULL || strcmp(pl->pl_path, path) == 0)){
+            *plp = pl->pl_next;
+            free(pl->pl_path);
+            free(pl);
+            n++;
+        }
+        else
+            plp = &pl->pl_next;
+    }
+    if (n)
+        pthread_cond_broadcast(&pm->pm_cond);
+    pthread_mutex_unlock(&pm->pm_mutex);
+    return n;
+}
+
+/*! Partial lock benchmark thread state
+ */
+struct plbench_thread {
+    struct plock_mgr *pt_pm;
+    pthread_t         pt_thread;
+    uint32_t          pt_id;     /* Session id */
+    int               pt_nr;     /* Number of lock/edit/unlock cycles */
+    uint64_t          pt_hold;   /* Simulated edit time in usecs */
+    int               pt_global; /* Lock "/" instead of own subtree */
+    struct bench_stat pt_stat;   /* Lock wait latencies */
+    int               pt_err;
+};
+
+/*! Benchmark thread: lock own subtree (or all), hold it for an edit, unlock
+ *
+ * The edit is simulated by spinning: libclixon is not thread-safe, so threads
+ * cannot edit a shared tree via xmldb here.
+ */
+static void *
+plbench_thread(void *arg)
+{
+    struct plbench_thread *pt = (struct plbench_thread *)arg;
+    char                   path[64];
+    struct timeval         t0;
+    struct timeval         t1;
+    struct timeval         td;
+    int                    i;
+
+    if (pt->pt_global)
+        snprintf(path, sizeof(path), "/");
+    else
+        snprintf(path, sizeof(path), "/config/session[id='%u']", pt->pt_id);
+    for (i=0; i<pt->pt_nr; i++){
+        gettimeofday(&t0, NULL);
+        if (plock_lock(pt->pt_pm, path, pt->pt_id, 1) < 0){
+            pt->pt_err = 1;
+            break;
+        }
+        gettimeofday(&t1, NULL);
+        timersub(&t1, &t0, &td);
+        if (bench_stat_add(&pt->pt_stat, timeval2usec(&td)) < 0){
+            pt->pt_err = 1;
+            break;
+        }
+        do {
+            gettimeofday(&t0, NULL);
+            timersub(&t0, &t1, &td);
+        } while (timeval2usec(&td) < pt->pt_hold);
+        plock_unlock(pt->pt_pm, path, pt->pt_id);
+    }
+    return NULL;
+}
+
+/*! Compare partial locks on disjoint subtrees with a global lock under contention
+ *
+ * @param[in]  nthreads  Number of sessions, one thread each
+ * @param[in]  nr        Lock/edit/unlock cycles per thread
+ * @param[in]  hold      Time a lock is held in usecs
+ */
+static int
+datastore_plbench(int      nthreads,
+                  int      nr,
+                  uint64_t hold)
+{
+    int                    retval = -1;
+    struct plock_mgr       pm;
+    struct plbench_thread *pt = NULL;
+    struct bench_stat      bs = {NULL, NULL, 0};
+    struct timeval         t0;
+    struct timeval         t1;
+    struct timeval         td;
+    int                    global;
+    int                    started;
+    int                    i;
+
+    if (plock_init(&pm) < 0)
+        goto done;
+    if ((pt = calloc(nthreads, sizeof(*pt))) == NULL){
+        clixon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    for (global=0; global<2; global++){
+        pm.pm_waits = 0;
+        gettimeofday(&t0, NULL);
+        for (started=0; started<nthreads; started++){
+            memset(&pt[started], 0, sizeof(*pt));
+            pt[started].pt_pm = &pm;
+            pt[started].pt_id = started + 1;
+            pt[started].pt_nr = nr;
+            pt[started].pt_hold = hold;
+            pt[started].pt_global = global;
+            if ((errno = pthread_create(&pt[started].pt_thread, NULL, plbench_thread, &pt[started])) != 0){
+                clixon_err(OE_UNIX, errno, "pthread_create");
+                break;
+            }
+        }
+        for (i=0; i<started; i++)
+            pthread_join(pt[i].pt_thread, NULL);
+        gettimeofday(&t1, NULL);
+        timersub(&t1, &t0, &td);
+        bs.bs_name = global ? "global" : "partial";
+        bs.bs_len = 0;
+        for (i=0; i<started; i++){
+            if (!pt[i].pt_err)
+                while (pt[i].pt_stat.bs_len)
+                    if (bench_stat_add(&bs, pt[i].pt_stat.bs_vec[--pt[i].pt_stat.bs_len]) < 0)
+                        pt[i].pt_err = 1;
+            if (pt[i].pt_stat.bs_vec)
+                free(pt[i].pt_stat.bs_vec);
+            pt[i].pt_stat.bs_vec = NULL;
+        }
+        if (started < nthreads)
+            goto done;
+        for (i=0; i<nthreads; i++)
+            if (pt[i].pt_err)
+                goto done;
+        fprintf(stdout, "%s: threads: %d edits: %d time: %lu.%06lu throughput: %.0f edits/s waits: %" PRIu64 "\n",
+                bs.bs_name, nthreads, nthreads*nr, td.tv_sec, td.tv_usec,
+                timeval2usec(&td) ? (double)nthreads*nr*1000000/timeval2usec(&td) : 0.0,
+                pm.pm_waits);
+        bench_stat_print(stdout, &bs);
+    }
+    retval = 0;
+ done:
+    if (bs.bs_vec)
+        free(bs.bs_vec);
+    if (pt)
+        free(pt);
+    plock_exit(&pm);
+    return retval;
+}
+
+/*! Copy a binary db by cloning its binary file
+ *
+ * If the source has no binary file, ie is empty, the binary file of the target is
+ * removed.
+ * @param[in]  h       Clixon handle
+ * @param[in]  from    Source database
+ * @param[in]  to      Target database
+ * @param[out] method  How it was copied
+ */
+static int
+bin_db_copy(clixon_handle h,
+            char         *from,
+            char         *to,
+            const char  **method)
+{
+    int         retval = -1;
+    char       *fromfile = NULL;
+    char       *tofile = NULL;
+    struct stat st;
+
+    if (bin_file(h, from, &fromfile) < 0)
+        goto done;
+    if (bin_file(h, to, &tofile) < 0)
+        goto done;
+    if (stat(fromfile, &st) < 0){
+        *method = "unlink";
+        if (unlink(tofile) < 0 && errno != ENOENT){
+            clixon_err(OE_UNIX, errno, "unlink(%s)", tofile);
+            goto done;
+        }
+    }
+    else if (file_clone(fromfile, tofile, method) < 0)
+        goto done;
+    retval = 0;
+ done:
+    if (tofile)
+        free(tofile);
+    if (fromfile)
+        free(fromfile);
+    return retval;
 }
 
 int
@@ -125,7 +4855,18 @@ main(int    argc,
     int                 dbg = 0;
     cxobj              *xerr = NULL;
     cxobj              *xcfg = NULL;
-    
+    struct ds_cache     cache = {0,};
+    int                 use_cache = 0;
+    int                 journal = 0;
+    int                 binary = 0;
+    size_t              journal_size = JOURNAL_COMPACT_SIZE;
+    enum ds_durability  durability = DS_SYNC;
+    uint64_t            window = GROUP_WINDOW_USEC;
+    char               *tracefile = NULL;
+    struct timeval      t0;
+    struct timeval      t1;
+    struct timeval      td;
+
     /* In the startup, logs to stderr & debug flag set later */
     if ((h = clixon_handle_init()) == NULL)
         goto done;
@@ -160,7 +4901,16 @@ main(int    argc,
         case 'f': /* db format */
             if (!optarg)
                 usage(argv0);
-            clicon_option_str_set(h, "CLICON_XMLDB_FORMAT", optarg);
+            if (strcmp(optarg, "journal") == 0){ /* XML snapshot + journal */
+                journal = 1;
+                clicon_option_str_set(h, "CLICON_XMLDB_FORMAT", "xml");
+            }
+            else if (strcmp(optarg, "binary") == 0){ /* mmap:ed binary file */
+                binary = 1;
+                clicon_option_str_set(h, "CLICON_XMLDB_FORMAT", "xml");
+            }
+            else
+                clicon_option_str_set(h, "CLICON_XMLDB_FORMAT", optarg);
             break;
         case 'x': /* XML file */
             if (!optarg)
@@ -176,6 +4926,36 @@ main(int    argc,
             if (clicon_option_add(h, "CLICON_YANG_DIR", optarg) < 0)
                 goto done;
             break;
+        case 'C': /* cache get results */
+            use_cache = 1;
+            break;
+        case 'J': /* journal compaction threshold */
+            if (!optarg)
+                usage(argv0);
+            journal_size = strtoul(optarg, NULL, 10);
+            break;
+        case 'S': /* put durability level */
+            if (!optarg)
+                usage(argv0);
+            if (strcmp(optarg, "sync") == 0)
+                durability = DS_SYNC;
+            else if (strcmp(optarg, "group") == 0)
+                durability = DS_GROUP;
+            else if (strcmp(optarg, "async") == 0)
+                durability = DS_ASYNC;
+            else
+                usage(argv0);
+            break;
+        case 'W': /* group commit window */
+            if (!optarg)
+                usage(argv0);
+            window = strtoull(optarg, NULL, 10);
+            break;
+        case 'T': /* trace file */
+            if (!optarg)
+                usage(argv0);
+            tracefile = optarg;
+            break;
         }
     /* 
      * Logs, error and debug to stderr, set debug level
@@ -208,18 +4988,74 @@ main(int    argc,
     if (yang_spec_parse_file(h, yangfilename, yspec) < 0)
         goto done;
     clicon_option_str_set(h, "CLICON_XMLDB_DIR", dbdir);
+    if (tracefile && trace_open(tracefile) < 0)
+        goto done;
     if (strcmp(cmd, "get")==0){
-        if (argc != 1 && argc != 2)
+        int   depth = 0;
+        cvec *fields = NULL;
+        char *fstr;
+        int   steps;
+        int   nodes;
+
+        for (i=1; i<argc && argv[i][0] == '-' && i+1 < argc; i+=2){
+            if (strcmp(argv[i], "-depth")==0){
+                if ((depth = atoi(argv[i+1])) < 1)
+                    usage(argv0);
+            }
+            else if (strcmp(argv[i], "-fields")==0){
+                if (fields == NULL && (fields = cvec_new(0)) == NULL){
+                    clixon_err(OE_UNIX, errno, "cvec_new");
+                    goto done;
+                }
+                fstr = argv[i+1];
+                if (fields_parse(NULL, &fstr, fields) < 0){
+                    cvec_free(fields);
+                    goto done;
+                }
+                if (*fstr != '\0'){
+                    clixon_err(OE_XML, EINVAL, "Invalid fields expression at: \"%s\"", fstr);
+                    cvec_free(fields);
+                    goto done;
+                }
+            }
+            else
+                usage(argv0);
+        }
+        if (argc - i > 1)
             usage(argv0);
-        if (argc==2)
-            xpath = argv[1];
+        if (i < argc)
+            xpath = argv[i];
         else
             xpath = "/";
-        if (xmldb_get(h, db, NULL, xpath, &xt) < 0)
+        if (journal || binary){
+            if (journal && journal_load(h, db, yspec, &xt, NULL) < 0)
+                goto done;
+            /* Levels below depth of the selected nodes are not read */
+            steps = xpath_steps(xpath);
+            if (binary && bin_db_load(h, db, yspec,
+                                      (depth && steps >= 0) ? (steps?steps:1) + depth - 1 : -1,
+                                      &xt) < 0)
+                goto done;
+            if (xml_filter_xpath(xt, xpath) < 0)
+                goto done;
+        }
+        else if (trace_get(h, db, NULL, xpath, &xt) < 0)
             goto done;
+        nodes = xml_nodes_count(xt);
+        if (depth || fields){
+            if (xml_filter_restconf(xt, xpath, depth, fields, yspec) < 0){
+                if (fields)
+                    cvec_free(fields);
+                goto done;
+            }
+        }
         if (clixon_xml2file(stdout, xt, 0, 0, NULL, fprintf, 0, 0) < 0)
             goto done;
         fprintf(stdout, "\n");
+        if (depth || fields)
+            fprintf(stdout, "nodes materialized: %d printed: %d\n", nodes, xml_nodes_count(xt));
+        if (fields)
+            cvec_free(fields);
         if (xt){
             xml_free(xt);
             xt = NULL;
@@ -234,8 +5070,30 @@ main(int    argc,
             xpath = argv[2];
         else
             xpath = "/";
+        if (use_cache && (journal || binary)){
+            clixon_err(OE_DB, 0, "mget: cache only with default datastore format");
+            goto done;
+        }
         for (i=0;i<nr;i++){
-            if (xmldb_get(h, db, NULL, xpath, &xt) < 0)
+            if (use_cache){
+                cxobj *xc = NULL;
+                if (ds_cache_get(&cache, h, db, xpath, &xc) < 0)
+                    goto done;
+                if (xc == NULL){
+                    clixon_err(OE_DB, 0, "xt is NULL");
+                    goto done;
+                }
+                if (clixon_xml2file(stdout, xc, 0, 0, NULL, fprintf, 0, 0) < 0)
+                    goto done;
+                continue;
+            }
+            if (journal || binary){
+                if (datastore_load(h, db, yspec, journal, binary, &xt) < 0)
+                    goto done;
+                if (xml_filter_xpath(xt, xpath) < 0)
+                    goto done;
+            }
+            else if (trace_get(h, db, NULL, xpath, &xt) < 0)
                 goto done;
             if (xt == NULL){
                 clixon_err(OE_DB, 0, "xt is NULL");
@@ -249,6 +5107,8 @@ main(int    argc,
             }
         }
         fprintf(stdout, "\n");
+        if (use_cache)
+            ds_cache_print(stdout, &cache);
     }
     else if (strcmp(cmd, "put")==0){
         if (argc == 2){
@@ -289,33 +5149,85 @@ main(int    argc,
             clixon_err(OE_UNIX, errno, "cbuf_new");
             goto done;
         }
-        if ((ret = xmldb_put(h, db, op, xt, NULL, cbret)) < 0)
-            goto done;
+        gettimeofday(&t0, NULL);
+        if (journal){ /* Journal appends are always synced */
+            if (journal_put(h, db, op, xt, yspec, journal_size) < 0)
+                goto done;
+        }
+        else if (binary){
+            if (bin_db_put(h, db, op, xt, yspec) < 0)
+                goto done;
+        }
+        else {
+            if ((ret = trace_put(h, db, op, xt, NULL, cbret)) < 0)
+                goto done;
+            if (ret == 1 && durability != DS_ASYNC && db_fsync(h, db) < 0)
+                goto done;
+            if (ret == 1 && hash_write(h, db, NULL, NULL) < 0)
+                goto done;
+        }
+        gettimeofday(&t1, NULL);
+        timersub(&t1, &t0, &td);
+        if (!journal && !binary && durability == DS_ASYNC)
+            fprintf(stderr, "put: async time: %" PRIu64 " usec throughput: %.0f puts/s loss window: %" PRIu64 " usec (kernel writeback)\n",
+                    timeval2usec(&td), timeval2usec(&td) ? 1000000.0/timeval2usec(&td) : 0.0,
+                    ds_writeback_usec());
+        else
+            fprintf(stderr, "put: %s time: %" PRIu64 " usec throughput: %.0f puts/s loss window: 0 usec\n",
+                    journal?"journal":binary?"binary":"sync", timeval2usec(&td),
+                    timeval2usec(&td) ? 1000000.0/timeval2usec(&td) : 0.0);
     }
     else if (strcmp(cmd, "copy")==0){
         if (argc != 2)
             usage(argv0);
-        if (xmldb_copy(h, db, argv[1]) < 0)
+        if (journal && journal_compact(h, db, yspec) < 0)
+            goto done;
+        if (binary){
+            const char *method;
+            if (bin_db_copy(h, db, argv[1], &method) < 0)
+                goto done;
+            clixon_debug(CLIXON_DBG_DEFAULT, "copy: %s", method);
+        }
+        else {
+            const char *method;
+            if (datastore_copy(h, db, argv[1], &method) < 0)
+                goto done;
+            clixon_debug(CLIXON_DBG_DEFAULT, "copy: %s", method);
+        }
+        if (journal){ /* Target is the compacted snapshot */
+            char *jfile = NULL;
+            if (journal_file(h, argv[1], &jfile) < 0)
+                goto done;
+            unlink(jfile);
+            free(jfile);
+        }
+    }
+    else if (strcmp(cmd, "copybench")==0){
+        if (argc != 3)
+            usage(argv0);
+        if (journal && journal_compact(h, db, yspec) < 0)
+            goto done;
+        if (datastore_copybench(h, db, argv[1], atoi(argv[2])) < 0)
             goto done;
     }
     else if (strcmp(cmd, "lock")==0){
         if (argc != 2)
             usage(argv0);
         id = atoi(argv[1]);
-        if (xmldb_lock(h, db, id) < 0)
+        if (trace_lock(h, db, id) < 0)
             goto done;
     }
     else if (strcmp(cmd, "unlock")==0){
         if (argc != 1)
             usage(argv0);
-        if (xmldb_unlock(h, db) < 0)
+        if (trace_unlock(h, db) < 0)
             goto done;
     }
     else if (strcmp(cmd, "unlock_all")==0){
         if (argc != 2)
             usage(argv0);
         id = atoi(argv[1]);
-        if (xmldb_unlock_all(h, id) < 0)
+        if (trace_unlock_all(h, id) < 0)
             goto done;
     }
     else if (strcmp(cmd, "islocked")==0){
@@ -328,20 +5240,229 @@ main(int    argc,
     else if (strcmp(cmd, "exists")==0){
         if (argc != 1)
             usage(argv0);
-        if ((ret = xmldb_exists(h, db)) < 0)
+        if (binary){ /* The binary file is the db */
+            char       *binfile = NULL;
+            struct stat st;
+            if (bin_file(h, db, &binfile) < 0)
+                goto done;
+            ret = stat(binfile, &st) == 0;
+            free(binfile);
+        }
+        else if ((ret = xmldb_exists(h, db)) < 0)
             goto done;
+        else if (ret == 0 && journal){ /* Journal without snapshot */
+            char       *jfile = NULL;
+            struct stat st;
+            if (journal_file(h, db, &jfile) < 0)
+                goto done;
+            ret = stat(jfile, &st) == 0;
+            free(jfile);
+        }
         fprintf(stdout, "exists: %d\n", ret);
     }
     else if (strcmp(cmd, "delete")==0){
         if (argc != 1)
             usage(argv0);
+        if (journal){
+            char *jfile = NULL;
+            if (journal_file(h, db, &jfile) < 0)
+                goto done;
+            unlink(jfile);
+            free(jfile);
+        }
+        if (binary){
+            char *binfile = NULL;
+            if (bin_file(h, db, &binfile) < 0)
+                goto done;
+            unlink(binfile);
+            free(binfile);
+        }
         if (xmldb_delete(h, db) < 0)
             goto done;
+        {
+            char *hfile = NULL;
+            if (hash_file(h, db, &hfile) < 0)
+                goto done;
+            unlink(hfile);
+            free(hfile);
+        }
     }
     else if (strcmp(cmd, "init")==0){
         if (argc != 1)
             usage(argv0);
-        if (xmldb_create(h, db) < 0)
+        if (binary){ /* Empty binary file, unless it exists */
+            char       *binfile = NULL;
+            struct stat st;
+            if (bin_file(h, db, &binfile) < 0)
+                goto done;
+            if (stat(binfile, &st) < 0){
+                if ((xt = xml_new(NETCONF_INPUT_CONFIG, NULL, CX_ELMNT)) == NULL ||
+                    bin_write(binfile, xt) < 0){
+                    free(binfile);
+                    goto done;
+                }
+            }
+            free(binfile);
+        }
+        else if (xmldb_create(h, db) < 0)
+            goto done;
+    }
+    else if (strcmp(cmd, "bench")==0){
+        if (argc != 4 && argc != 5)
+            usage(argv0);
+        if (argc==5)
+            xpath = argv[4];
+        else
+            xpath = "/";
+        if (journal || binary){
+            clixon_err(OE_DB, 0, "bench: only default datastore format");
+            goto done;
+        }
+        if (datastore_bench(h, db, yspec, xmlfilename,
+                            atoi(argv[1]), atoi(argv[2]), atoi(argv[3]), xpath,
+                            use_cache?&cache:NULL) < 0)
+            goto done;
+    }
+    else if (strcmp(cmd, "compact")==0){
+        if (argc != 1)
+            usage(argv0);
+        if (journal_compact(h, db, yspec) < 0)
+            goto done;
+    }
+    else if (strcmp(cmd, "jbench")==0){
+        if (argc != 2)
+            usage(argv0);
+        if (journal_bench(h, db, yspec, xmlfilename, atoi(argv[1])) < 0)
+            goto done;
+    }
+    else if (strcmp(cmd, "export")==0){
+        if (argc != 3)
+            usage(argv0);
+        if (datastore_load(h, db, yspec, journal, binary, &xt) < 0)
+            goto done;
+        if (datastore_file_write(argv[1], argv[2], xt) < 0)
+            goto done;
+    }
+    else if (strcmp(cmd, "import")==0){
+        if (argc != 3)
+            usage(argv0);
+        if (datastore_file_load(h, argv[1], argv[2], yspec, &xt) < 0)
+            goto done;
+        if (xml_name_set(xt, NETCONF_INPUT_CONFIG) < 0)
+            goto done;
+        if (binary){
+            char *binfile = NULL;
+            if (bin_file(h, db, &binfile) < 0)
+                goto done;
+            ret = bin_write(binfile, xt);
+            free(binfile);
+            if (ret < 0)
+                goto done;
+        }
+        else {
+            if ((cbret = cbuf_new()) == NULL){
+                clixon_err(OE_UNIX, errno, "cbuf_new");
+                goto done;
+            }
+            if (journal && journal_compact(h, db, yspec) < 0)
+                goto done;
+            if ((ret = trace_put(h, db, OP_REPLACE, xt, NULL, cbret)) < 0)
+                goto done;
+            if (ret == 0){
+                clixon_err(OE_DB, 0, "import: %s", cbuf_get(cbret));
+                goto done;
+            }
+        }
+    }
+    else if (strcmp(cmd, "split")==0){
+        if (argc != 1)
+            usage(argv0);
+        if (split_build(h, db, yspec, journal, binary) < 0)
+            goto done;
+    }
+    else if (strcmp(cmd, "lget")==0){
+        if (argc != 1 && argc != 2)
+            usage(argv0);
+        if (split_get(h, db, yspec, journal, binary, argc==2?argv[1]:"/") < 0)
+            goto done;
+    }
+    else if (strcmp(cmd, "stress")==0){
+        if (argc != 3)
+            usage(argv0);
+        if (datastore_load(h, db, yspec, journal, binary, &xt) < 0)
+            goto done;
+        ret = snap_stress(xt, yspec, xmlfilename, atoi(argv[1]), atoi(argv[2]));
+        xt = NULL; /* consumed */
+        if (ret < 0)
+            goto done;
+    }
+    else if (strcmp(cmd, "hash")==0 || strcmp(cmd, "unchanged-since")==0){
+        uint64_t hash;
+        uint64_t since;
+        cbuf    *cbh;
+
+        if (strcmp(cmd, "hash")==0 ? argc != 1 : argc != 2)
+            usage(argv0);
+        if (journal || binary){
+            clixon_err(OE_DB, 0, "%s: only default datastore format", cmd);
+            goto done;
+        }
+        if ((cbh = cbuf_new()) == NULL){
+            clixon_err(OE_UNIX, errno, "cbuf_new");
+            goto done;
+        }
+        if ((ret = hash_get(h, db, &hash, cbh)) < 0){
+            cbuf_free(cbh);
+            goto done;
+        }
+        if (argc == 1)
+            fprintf(stdout, "hash %016" PRIx64 " (%s)\n%s",
+                    hash, ret?"metadata":"recomputed", cbuf_get(cbh));
+        else {
+            since = strtoull(argv[1], NULL, 16);
+            fprintf(stdout, "%s %016" PRIx64 " (%s)\n",
+                    hash == since ? "unchanged" : "changed",
+                    hash, ret?"metadata":"recomputed");
+        }
+        cbuf_free(cbh);
+    }
+    else if (strcmp(cmd, "wbench")==0){
+        if (argc != 2)
+            usage(argv0);
+        if (xmlfilename == NULL){
+            clixon_err(OE_DB, 0, "XML filename expected");
+            usage(argv0);
+        }
+        if (journal || binary){
+            clixon_err(OE_DB, 0, "wbench: only default datastore format");
+            goto done;
+        }
+        if (datastore_wbench(h, db, yspec, xmlfilename, atoi(argv[1]), durability, window) < 0)
+            goto done;
+    }
+    else if (strcmp(cmd, "plbench")==0){
+        if (argc != 3 && argc != 4)
+            usage(argv0);
+        if (datastore_plbench(atoi(argv[1]), atoi(argv[2]),
+                              argc==4?strtoull(argv[3], NULL, 10):50) < 0)
+            goto done;
+    }
+    else if (strcmp(cmd, "replay")==0){
+        if (argc != 2 && argc != 3)
+            usage(argv0);
+        if (datastore_replay(h, yspec, argv[1], argc==3?atof(argv[2]):1.0) < 0)
+            goto done;
+    }
+    else if (strcmp(cmd, "txn")==0){
+        if (argc != 2)
+            usage(argv0);
+        if (datastore_txn(h, db, yspec, argv[1], journal, binary) < 0)
+            goto done;
+    }
+    else if (strcmp(cmd, "coldload")==0){
+        if (argc != 3 && argc != 4)
+            usage(argv0);
+        if (datastore_coldload(h, argv[1], argv[2], yspec, argc==4?atoi(argv[3]):1) < 0)
             goto done;
     }
     else{
@@ -350,9 +5471,12 @@ main(int    argc,
     }
     if (xmldb_disconnect(h) < 0)
         goto done;
-
+    if (trace_close() < 0)
+        goto done;
     retval = 0;
   done:
+    trace_close();
+    ds_cache_free(&cache);
     yang_exit(h);
     if (xcfg)
         xml_free(xcfg);
@@ -50,7 +50,10 @@
 #include <syslog.h>
 #include <fcntl.h>
 #include <signal.h>
+#include <dirent.h>
+#include <sys/time.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 
 /* cligen */
 #include <cligen/cligen.h>
@@ -59,7 +62,7 @@
 #include "clixon/clixon.h"
 
 /* Command line options to be passed to getopt(3) */
-#define UTIL_PATH_OPTS "hD:f:ap:y:Y:n:"
+#define UTIL_PATH_OPTS "hD:f:ap:ry:Y:n:d:P:j:o:"
 
 static int
 usage(char *argv0)
@@ -71,18 +74,643 @@ usage(char *argv0)
             "\t-f <file>  \tXML file\n"
             "\t-a \t\tUse API-PATH (default INSTANCE-ID)\n"
             "\t-p <xpath> \tPATH string\n"
+            "\t-r \t\tReverse: print api-path of nodes matching XPath -p, or of all nodes\n"
             "\t-y <filename> \tYang filename or dir (load all files)\n"
             "\t-Y <dir> \tYang dirs (can be several)\n"
             "\t-n <n>   \tRepeat the call n times(for profiling)\n"
+            "\t-d <dir> \tDirectory of XML/JSON files (*.xml, *.json), requires -P and -y\n"
+            "\t-P <file> \tFile with one path per line, resolved in every file of -d\n"
+            "\t-j <n>   \tNumber of worker processes for -d (default 1)\n"
+            "\t-o <fmt> \tOutput format for -d: csv or jsonl (default csv)\n"
             "and the following extra rules:\n"
             "\tif -f is not given, XML input is expected on stdin\n"
             "\tif -p is not given, <path> is expected as the first line on stdin\n"
+            "\tif -r is given, -y is required and -p is optional\n"
             "This means that with no arguments, <api-path> and XML is expected on stdin.\n",
             argv0
             );
     exit(0);
 }
 
+/*! Append the api-path segment of one XML node to a buffer
+ *
+ * The segment is "/[<module>:]<name>[=<key>(,<key>)*]" as defined in RFC 8040 3.5.3,
+ * where the module is the one of the node's namespace, only given if the namespace
+ * differs from the parent's, and keys are percent-encoded. The namespace, not the
+ * defining YANG module, gives the right module for augmented nodes and submodules.
+ * @param[in]  x   XML node, bound to YANG
+ * @param[in]  cb  Buffer containing api-path of parent, segment is appended
+ * @retval     0   OK
+ * @retval    -1   Error
+ */
+static int
+api_path_segment(cxobj *x,
+                 cbuf  *cb)
+{
+    int        retval = -1;
+    yang_stmt *y;
+    yang_stmt *yp;
+    yang_stmt *ymod;
+    cxobj     *xp;
+    char      *ns = NULL;
+    char      *nsp = NULL;
+    cvec      *cvk;
+    cg_var    *cvi;
+    char      *keyval;
+    char      *enc = NULL;
+    int        i;
+
+    cprintf(cb, "/");
+    if ((y = xml_spec(x)) != NULL){
+        if (xml2ns(x, xml_prefix(x), &ns) < 0)
+            goto done;
+        if (ns == NULL)
+            ns = yang_find_mynamespace(y);
+    }
+    if ((xp = xml_parent(x)) != NULL &&
+        (yp = xml_spec(xp)) != NULL &&
+        yang_keyword_get(yp) != Y_SPEC){
+        if (xml2ns(xp, xml_prefix(xp), &nsp) < 0)
+            goto done;
+        if (nsp == NULL)
+            nsp = yang_find_mynamespace(yp);
+    }
+    if (ns != NULL && (nsp == NULL || strcmp(ns, nsp) != 0) &&
+        (ymod = yang_find_module_by_namespace(ys_spec(y), ns)) != NULL)
+        cprintf(cb, "%s:", yang_argument_get(ymod));
+    cprintf(cb, "%s", xml_name(x));
+    if (y == NULL)
+        goto ok;
+    switch (yang_keyword_get(y)){
+    case Y_LIST:
+        cvk = yang_cvec_get(y);
+        i = 0;
+        cvi = NULL;
+        while ((cvi = cvec_each(cvk, cvi)) != NULL){
+            if ((keyval = xml_find_body(x, cv_string_get(cvi))) == NULL)
+                keyval = "";
+            if (uri_percent_encode(&enc, "%s", keyval) < 0)
+                goto done;
+            cprintf(cb, "%s%s", i++?",":"=", enc);
+            free(enc);
+            enc = NULL;
+        }
+        break;
+    case Y_LEAF_LIST:
+        if ((keyval = xml_body(x)) == NULL)
+            keyval = "";
+        if (uri_percent_encode(&enc, "%s", keyval) < 0)
+            goto done;
+        cprintf(cb, "=%s", enc);
+        break;
+    default:
+        break;
+    }
+ ok:
+    retval = 0;
+ done:
+    if (enc)
+        free(enc);
+    return retval;
+}
+
+/*! Append api-path of all ancestors of an XML node (but not the node itself)
+ *
+ * @param[in]  x   XML node
+ * @param[in]  cb  Buffer where api-path is appended
+ */
+static int
+api_path_prefix(cxobj *x,
+                cbuf  *cb)
+{
+    cxobj *xp;
+
+    if ((xp = xml_parent(x)) == NULL || xml_parent(xp) == NULL)
+        return 0;
+    if (api_path_prefix(xp, cb) < 0)
+        return -1;
+    return api_path_segment(xp, cb);
+}
+
+/*! Print api-path of an XML node and, optionally, of all its descendants
+ *
+ * The buffer is extended with one segment per level and truncated back on return,
+ * so the api-path of each ancestor is computed only once and the total work is
+ * linear in the size of the output.
+ * @param[in]  f       Output file
+ * @param[in]  x       XML node
+ * @param[in]  cb      Buffer with api-path of the parent of x
+ * @param[in]  recurse If set, also print api-path of all descendants
+ */
+static int
+api_path_print(FILE  *f,
+               cxobj *x,
+               cbuf  *cb,
+               int    recurse)
+{
+    int    retval = -1;
+    size_t len;
+    cxobj *xc;
+
+    len = cbuf_len(cb);
+    if (api_path_segment(x, cb) < 0)
+        goto done;
+    fprintf(f, "%s\n", cbuf_get(cb));
+    if (recurse){
+        xc = NULL;
+        while ((xc = xml_child_each(x, xc, CX_ELMNT)) != NULL)
+            if (api_path_print(f, xc, cb, recurse) < 0)
+                goto done;
+    }
+    cbuf_trunc(cb, len);
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Print api-path of all nodes matching an XPath, or all nodes of the tree
+ *
+ * @param[in]  xt     XML tree, bound to YANG and sorted
+ * @param[in]  yspec  YANG spec
+ * @param[in]  xpath  XPath selector. If NULL, print all nodes in xt
+ */
+static int
+api_path_reverse(cxobj     *xt,
+                 yang_stmt *yspec,
+                 char      *xpath)
+{
+    int     retval = -1;
+    cbuf   *cb = NULL;
+    cvec   *nsc = NULL;
+    xp_ctx *xc = NULL;
+    cxobj  *x;
+    int     i;
+
+    if ((cb = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    if (xpath == NULL){
+        x = NULL;
+        while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL)
+            if (api_path_print(stdout, x, cb, 1) < 0)
+                goto done;
+    }
+    else {
+        if (xml_nsctx_yangspec(yspec, &nsc) < 0)
+            goto done;
+        if (xpath_vec_ctx(xt, nsc, xpath, 0, &xc) < 0)
+            goto done;
+        if (xc->xc_type != XT_NODESET){
+            clixon_err(OE_XML, 0, "xpath %s does not evaluate to a nodeset", xpath);
+            goto done;
+        }
+        for (i=0; i<xc->xc_size; i++){
+            x = xc->xc_nodeset[i];
+            if (xml_parent(x) == NULL) /* top: no api-path */
+                continue;
+            cbuf_reset(cb);
+            if (api_path_prefix(x, cb) < 0)
+                goto done;
+            if (api_path_print(stdout, x, cb, 0) < 0)
+                goto done;
+        }
+    }
+    fflush(stdout);
+    retval = 0;
+ done:
+    if (xc)
+        ctx_free(xc);
+    if (nsc)
+        cvec_free(nsc);
+    if (cb)
+        cbuf_free(cb);
+    return retval;
+}
+
+/*! Read a file with one path per line, skip empty lines and lines starting with '#'
+ *
+ * @param[in]  filename  File with paths
+ * @param[out] pathsp    Vector of malloced paths, free with free
+ * @param[out] npathsp   Length of vector
+ */
+static int
+path_list_read(char   *filename,
+               char ***pathsp,
+               int    *npathsp)
+{
+    int     retval = -1;
+    FILE   *fp = NULL;
+    char   *line = NULL;
+    size_t  linelen = 0;
+    ssize_t len;
+    char  **paths = NULL;
+    int     npaths = 0;
+
+    if ((fp = fopen(filename, "r")) == NULL){
+        clixon_err(OE_UNIX, errno, "fopen(%s)", filename);
+        goto done;
+    }
+    while ((len = getline(&line, &linelen, fp)) != -1){
+        while (len > 0 && (line[len-1] == '\n' || line[len-1] == '\r'))
+            line[--len] = '\0';
+        if (len == 0 || line[0] == '#')
+            continue;
+        if ((paths = realloc(paths, (npaths+1)*sizeof(char*))) == NULL){
+            clixon_err(OE_UNIX, errno, "realloc");
+            goto done;
+        }
+        if ((paths[npaths] = strdup(line)) == NULL){
+            clixon_err(OE_UNIX, errno, "strdup");
+            goto done;
+        }
+        npaths++;
+    }
+    *pathsp = paths;
+    *npathsp = npaths;
+    paths = NULL;
+    retval = 0;
+ done:
+    if (paths){
+        while (npaths--)
+            free(paths[npaths]);
+        free(paths);
+    }
+    if (line)
+        free(line);
+    if (fp)
+        fclose(fp);
+    return retval;
+}
+
+/*! Print a value as a CSV field, quoted if necessary
+ */
+static void
+csv_print(FILE *f,
+          char *str)
+{
+    char *s;
+
+    if (strpbrk(str, ",\"\n\r") == NULL){
+        fprintf(f, "%s", str);
+        return;
+    }
+    fputc('"', f);
+    for (s=str; *s; s++){
+        if (*s == '"')
+            fputc('"', f);
+        fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+/*! Print a value as a JSON string
+ */
+static void
+json_str_print(FILE *f,
+               char *str)
+{
+    char *s;
+
+    fputc('"', f);
+    for (s=str; *s; s++){
+        switch (*s){
+        case '"':
+            fprintf(f, "\\\"");
+            break;
+        case '\\':
+            fprintf(f, "\\\\");
+            break;
+        case '\n':
+            fprintf(f, "\\n");
+            break;
+        case '\r':
+            fprintf(f, "\\r");
+            break;
+        case '\t':
+            fprintf(f, "\\t");
+            break;
+        default:
+            if ((unsigned char)*s < 0x20)
+                fprintf(f, "\\u%04x", *s);
+            else
+                fputc(*s, f);
+            break;
+        }
+    }
+    fputc('"', f);
+}
+
+/*! Parse and bind one XML or JSON data file, format is given by file suffix
+ *
+ * @param[in]  h         Clixon handle
+ * @param[in]  filename  Data file, JSON if suffix is .json, otherwise XML
+ * @param[in]  yspec     YANG spec
+ * @param[out] xtp       XML tree, free with xml_free
+ * @retval     1         OK
+ * @retval     0         Open, parse or bind error, reason in clixon_err_reason()
+ * @retval    -1         Error
+ */
+static int
+multi_parse(clixon_handle h,
+            char         *filename,
+            yang_stmt    *yspec,
+            cxobj       **xtp)
+{
+    int    retval = -1;
+    FILE  *fp = NULL;
+    cxobj *xerr = NULL;
+    char  *suffix;
+    int    ret;
+
+    if ((fp = fopen(filename, "r")) == NULL){
+        clixon_err(OE_UNIX, errno, "fopen(%s)", filename);
+        goto fail;
+    }
+    if ((suffix = strrchr(filename, '.')) != NULL && strcmp(suffix, ".json") == 0)
+        ret = clixon_json_parse_file(fp, 1, YB_MODULE, yspec, xtp, &xerr);
+    else
+        ret = clixon_xml_parse_file(fp, YB_MODULE, yspec, xtp, &xerr);
+    if (ret < 0)
+        goto done;
+    if (ret == 0){
+        clixon_err_netconf(h, OE_XML, 0, xerr, "%s", filename);
+        goto fail;
+    }
+    if (xml_sort_recurse(*xtp) < 0)
+        goto done;
+    retval = 1;
+ done:
+    if (xerr)
+        xml_free(xerr);
+    if (fp)
+        fclose(fp);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Resolve a set of paths in one data file and print one output row
+ *
+ * The value of a path is the bodies of all matching nodes separated by space.
+ * A path without matches gives an empty CSV field or a JSON null.
+ * A file that cannot be opened, parsed or bound gives an error row: empty CSV fields
+ * and the reason in the last "error" column, or a JSON "error" member instead of
+ * "values".
+ * @param[in]  h          Clixon handle
+ * @param[in]  f          Output file
+ * @param[in]  dir        Directory of data file
+ * @param[in]  name       Name of data file in dir
+ * @param[in]  yspec      YANG spec, shared read-only
+ * @param[in]  paths      Vector of paths
+ * @param[in]  npaths     Length of paths
+ * @param[in]  api_path_p If set, paths are api-paths, otherwise instance-ids
+ * @param[in]  jsonl      If set, print JSONL, otherwise CSV
+ */
+static int
+multi_file(clixon_handle h,
+           FILE         *f,
+           char         *dir,
+           char         *name,
+           yang_stmt    *yspec,
+           char        **paths,
+           int           npaths,
+           int           api_path_p,
+           int           jsonl)
+{
+    int     retval = -1;
+    cbuf   *cb = NULL;
+    cbuf   *cbv = NULL;
+    cxobj  *xt = NULL;
+    cxobj **xvec = NULL;
+    int     xlen = 0;
+    char   *body;
+    int     i;
+    int     j;
+    int     ret;
+
+    if ((cb = cbuf_new()) == NULL || (cbv = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    cprintf(cb, "%s/%s", dir, name);
+    if ((ret = multi_parse(h, cbuf_get(cb), yspec, &xt)) < 0)
+        goto done;
+    if (ret == 0){ /* Error row */
+        if (jsonl){
+            fprintf(f, "{\"file\":");
+            json_str_print(f, name);
+            fprintf(f, ",\"error\":");
+            json_str_print(f, clixon_err_reason() ? clixon_err_reason() : "");
+            fprintf(f, "}\n");
+        }
+        else{
+            csv_print(f, name);
+            for (i=0; i<npaths; i++)
+                fputc(',', f);
+            fputc(',', f);
+            csv_print(f, clixon_err_reason() ? clixon_err_reason() : "");
+            fputc('\n', f);
+        }
+        goto ok;
+    }
+    if (jsonl){
+        fprintf(f, "{\"file\":");
+        json_str_print(f, name);
+        fprintf(f, ",\"values\":{");
+    }
+    else
+        csv_print(f, name);
+    for (i=0; i<npaths; i++){
+        if (api_path_p)
+            ret = clixon_xml_find_api_path(xt, yspec, &xvec, &xlen, "%s", paths[i]);
+        else
+            ret = clixon_xml_find_instance_id(xt, yspec, &xvec, &xlen, "%s", paths[i]);
+        if (ret < 0)
+            goto done;
+        if (ret == 0){
+            fprintf(stderr, "Fail %s: %s %s\n", name, paths[i], clixon_err_reason());
+            xlen = 0;
+        }
+        cbuf_reset(cbv);
+        for (j=0; j<xlen; j++)
+            if ((body = xml_body(xvec[j])) != NULL)
+                cprintf(cbv, "%s%s", cbuf_len(cbv)?" ":"", body);
+        if (jsonl){
+            if (i)
+                fputc(',', f);
+            json_str_print(f, paths[i]);
+            fputc(':', f);
+            if (xlen)
+                json_str_print(f, cbuf_get(cbv));
+            else
+                fprintf(f, "null");
+        }
+        else{
+            fputc(',', f);
+            csv_print(f, cbuf_get(cbv));
+        }
+        if (xvec){
+            free(xvec);
+            xvec = NULL;
+        }
+        xlen = 0;
+    }
+    fprintf(f, jsonl?"}}\n":",\n");
+ ok:
+    retval = 0;
+ done:
+    if (xvec)
+        free(xvec);
+    if (xt)
+        xml_free(xt);
+    if (cbv)
+        cbuf_free(cbv);
+    if (cb)
+        cbuf_free(cb);
+    return retval;
+}
+
+/*! Resolve the same set of paths in all XML/JSON files of a directory
+ *
+ * Files are statically partitioned in consecutive ranges over a number of worker
+ * processes. The YANG spec is loaded once before fork and shared read-only by all
+ * workers. Processes are used instead of threads since the clixon parsers and error
+ * handling are not reentrant.
+ * Each worker writes its rows to a private temporary file, which are concatenated
+ * in worker order, so the output is in file order regardless of nr of workers.
+ * @param[in]  h          Clixon handle
+ * @param[in]  yspec      YANG spec
+ * @param[in]  dir        Directory of XML (*.xml) and JSON (*.json) files
+ * @param[in]  pathfile   File with one path per line
+ * @param[in]  api_path_p If set, paths are api-paths, otherwise instance-ids
+ * @param[in]  workers    Number of worker processes
+ * @param[in]  jsonl      If set, output JSONL, otherwise CSV
+ */
+static int
+multi_run(clixon_handle h,
+          yang_stmt    *yspec,
+          char         *dir,
+          char         *pathfile,
+          int           api_path_p,
+          int           workers,
+          int           jsonl)
+{
+    int            retval = -1;
+    struct dirent *dp = NULL;
+    int            ndp;
+    char         **paths = NULL;
+    int            npaths = 0;
+    FILE         **fps = NULL;
+    pid_t         *pids = NULL;
+    struct timeval t0;
+    struct timeval t1;
+    struct timeval td;
+    int            status;
+    int            failed = 0;
+    int            k;
+    int            i;
+    int            c;
+
+    gettimeofday(&t0, NULL);
+    if (path_list_read(pathfile, &paths, &npaths) < 0)
+        goto done;
+    if ((ndp = clicon_file_dirent(dir, &dp, "\\.(xml|json)$", S_IFREG)) < 0)
+        goto done;
+    if (workers < 1)
+        workers = 1;
+    if (workers > ndp)
+        workers = ndp?ndp:1;
+    if (!jsonl){
+        fprintf(stdout, "file");
+        for (i=0; i<npaths; i++){
+            fputc(',', stdout);
+            csv_print(stdout, paths[i]);
+        }
+        fprintf(stdout, ",error\n");
+    }
+    fflush(stdout);
+    if (workers == 1){
+        for (i=0; i<ndp; i++)
+            if (multi_file(h, stdout, dir, dp[i].d_name, yspec, paths, npaths, api_path_p, jsonl) < 0)
+                goto done;
+    }
+    else {
+        if ((fps = calloc(workers, sizeof(FILE*))) == NULL ||
+            (pids = calloc(workers, sizeof(pid_t))) == NULL){
+            clixon_err(OE_UNIX, errno, "calloc");
+            goto done;
+        }
+        for (k=0; k<workers; k++){
+            if ((fps[k] = tmpfile()) == NULL){
+                clixon_err(OE_UNIX, errno, "tmpfile");
+                goto done;
+            }
+            if ((pids[k] = fork()) < 0){
+                clixon_err(OE_UNIX, errno, "fork");
+                goto done;
+            }
+            if (pids[k] == 0){ /* Worker */
+                status = 0;
+                for (i=k*ndp/workers; i<(k+1)*ndp/workers; i++)
+                    if (multi_file(h, fps[k], dir, dp[i].d_name, yspec, paths, npaths, api_path_p, jsonl) < 0){
+                        status = 1;
+                        break;
+                    }
+                fflush(fps[k]);
+                _exit(status);
+            }
+        }
+        for (k=0; k<workers; k++){
+            if (waitpid(pids[k], &status, 0) < 0){
+                clixon_err(OE_UNIX, errno, "waitpid");
+                goto done;
+            }
+            pids[k] = 0;
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                failed++;
+        }
+        /* Fail as -j 1 does, rows of the other workers are not printed */
+        if (failed){
+            clixon_err(OE_UNIX, 0, "%d of %d workers failed", failed, workers);
+            goto done;
+        }
+        for (k=0; k<workers; k++){
+            rewind(fps[k]);
+            while ((c = fgetc(fps[k])) != EOF)
+                fputc(c, stdout);
+        }
+    }
+    fflush(stdout);
+    gettimeofday(&t1, NULL);
+    timersub(&t1, &t0, &td);
+    fprintf(stderr, "files: %d paths: %d workers: %d time: %lu.%06lu s\n",
+            ndp, npaths, workers, td.tv_sec, td.tv_usec);
+    retval = 0;
+ done:
+    if (pids){
+        for (k=0; k<workers; k++)
+            if (pids[k] > 0)
+                waitpid(pids[k], NULL, 0);
+        free(pids);
+    }
+    if (fps){
+        for (k=0; k<workers; k++)
+            if (fps[k])
+                fclose(fps[k]);
+        free(fps);
+    }
+    if (paths){
+        for (i=0; i<npaths; i++)
+            free(paths[i]);
+        free(paths);
+    }
+    if (dp)
+        free(dp);
+    return retval;
+}
+
 int
 main(int    argc,
      char **argv)
@@ -111,6 +739,11 @@ main(int    argc,
     cxobj        *xerr = NULL; /* malloced must be freed */
     int           nr = 1;
     int           dbg = 0;
+    int           reverse = 0;
+    char         *dir = NULL;
+    char         *pathfile = NULL;
+    int           workers = 1;
+    int           jsonl = 0;
 
     /* In the startup, logs to stderr & debug flag set later */
     if ((h = clixon_handle_init()) == NULL)
@@ -147,6 +780,9 @@ main(int    argc,
         case 'p': /* API-PATH string */
             path = optarg;
             break;
+        case 'r': /* Reverse: XML to api-path */
+            reverse++;
+            break;
         case 'y':
             yang_file_dir = optarg;
             break;
@@ -157,10 +793,33 @@ main(int    argc,
         case 'n':
             nr = atoi(optarg);
             break;
+        case 'd': /* Directory of data files */
+            dir = optarg;
+            break;
+        case 'P': /* File with paths */
+            pathfile = optarg;
+            break;
+        case 'j': /* Worker processes */
+            workers = atoi(optarg);
+            break;
+        case 'o': /* Output format */
+            if (strcmp(optarg, "jsonl") == 0)
+                jsonl = 1;
+            else if (strcmp(optarg, "csv") != 0)
+                usage(argv0);
+            break;
         default:
             usage(argv[0]);
             break;
         }
+    if (reverse && yang_file_dir == NULL){
+        fprintf(stderr, "-r requires -y\n");
+        usage(argv0);
+    }
+    if (dir && (pathfile == NULL || yang_file_dir == NULL)){
+        fprintf(stderr, "-d requires -P and -y\n");
+        usage(argv0);
+    }
     clixon_debug_init(h, dbg);
     if (yang_init(h) < 0)
         goto done;
@@ -183,7 +842,13 @@ main(int    argc,
         }
     }
 
-    if (path==NULL){
+    /* Multi-file: resolve path list in all files of a directory */
+    if (dir){
+        if (multi_run(h, yspec, dir, pathfile, api_path_p, workers, jsonl) < 0)
+            goto done;
+        goto ok;
+    }
+    if (path==NULL && !reverse){
         /* First read api-path from file */
         len = 1024; /* any number is fine */
         if ((buf = malloc(len)) == NULL){
@@ -262,6 +927,12 @@ main(int    argc,
         }
 
     }
+    /* Reverse: map XML nodes to api-paths */
+    if (reverse){
+        if (api_path_reverse(x, yspec, path) < 0)
+            goto done;
+        goto ok;
+    }
     /* Repeat for performance profiling (default is nr = 1) */
     xvec = NULL;
     for (i=0; i<nr; i++){
@@ -288,6 +959,7 @@ main(int    argc,
         fputc('\n', stdout);
         fflush(stdout);
     }
+ ok:
     retval = 0;
  done:
     yang_exit(h);
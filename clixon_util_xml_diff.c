@@ -32,6 +32,7 @@
   ***** END LICENSE BLOCK *****
 
  * Compare XML trees
+ * With two trees, print the edit-config that transforms x0 into x1
  * Test uses three trees:
  * x0 - Orig
  * x1 - Candidate
@@ -49,12 +50,16 @@
 #include <string.h>
 #include <limits.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <syslog.h>
 #include <fcntl.h>
 #include <signal.h>
 #include <assert.h>
+#include <pthread.h>
+#include <dirent.h>
 #include <sys/time.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 
 /* cligen */
 #include <cligen/cligen.h>
@@ -63,7 +68,7 @@
 #include "clixon/clixon.h"
 
 /* Command line options passed to getopt(3) */
-#define UTIL_XML_OPTS "hD:l:f:i:o:y:Y:u"
+#define UTIL_XML_OPTS "hD:l:f:i:o:y:Y:uBmH:j:Mb:S"
 
 static int
 validate_tree(clixon_handle h,
@@ -104,6 +109,3291 @@ validate_tree(clixon_handle h,
     return retval;
 }
 
+/*! Detect format of a file from its first non-whitespace character
+ *
+ * < is XML, { or [ is JSON, anything else is TEXT
+ */
+static enum format_enum
+diff_format_detect(FILE *fp)
+{
+    int c;
+
+    while ((c = getc(fp)) == ' ' || c == '\t' || c == '\r' || c == '\n')
+        ;
+    if (c == EOF)
+        return FORMAT_XML;
+    ungetc(c, fp);
+    if (c == '<')
+        return FORMAT_XML;
+    if (c == '{' || c == '[')
+        return FORMAT_JSON;
+    return FORMAT_TEXT;
+}
+
+/*! Parse a file in a format and bind to yang
+ *
+ * @param[in]  h       Clixon handle
+ * @param[in]  fp      Open file
+ * @param[in]  format  Format of file
+ * @param[in]  yspec   Yang spec
+ * @param[out] xt      Parsed tree, free with xml_free
+ */
+static int
+diff_parse(clixon_handle    h,
+           FILE            *fp,
+           enum format_enum format,
+           yang_stmt       *yspec,
+           cxobj          **xt)
+{
+    int    retval = -1;
+    cxobj *xerr = NULL;
+    int    ret;
+
+    switch (format){
+    case FORMAT_XML:
+        if ((ret = clixon_xml_parse_file(fp, YB_MODULE, yspec, xt, &xerr)) < 0)
+            goto done;
+        break;
+    case FORMAT_TEXT:
+        if ((ret = clixon_text_syntax_parse_file(fp, YB_MODULE, yspec, xt, &xerr)) < 0)
+            goto done;
+        break;
+    case FORMAT_JSON:
+        if ((ret = clixon_json_parse_file(fp, 1, YB_MODULE, yspec, xt, &xerr)) < 0)
+            goto done;
+        break;
+    default:
+        clixon_err(OE_XML, 0, "Unsupported format");
+        goto done;
+        break;
+    }
+    if (ret == 0){
+        clixon_err_netconf(h, OE_XML, 0, xerr, "util_xml");
+        goto done;
+    }
+    retval = 0;
+ done:
+    if (xerr)
+        xml_free(xerr);
+    return retval;
+}
+
+/*! Parse and validate a file
+ *
+ * @param[in]  h         Clixon handle
+ * @param[in]  filename  File
+ * @param[in]  format    Format of file
+ * @param[in]  detect    Detect format from file content, format is not used
+ * @param[in]  yspec     Yang spec
+ * @param[out] xt        Parsed tree, free with xml_free
+ */
+static int
+diff_parse_file(clixon_handle    h,
+                char            *filename,
+                enum format_enum format,
+                int              detect,
+                yang_stmt       *yspec,
+                cxobj          **xt)
+{
+    int    retval = -1;
+    FILE  *fp = NULL;
+
+    if ((fp = fopen(filename, "r")) == NULL){
+        clixon_err(OE_YANG, errno, "open(%s)", filename);
+        goto done;
+    }
+    if (detect)
+        format = diff_format_detect(fp);
+    if (diff_parse(h, fp, format, yspec, xt) < 0)
+        goto done;
+    if (validate_tree(h, *xt, yspec) < 0)
+        goto done;
+    retval = 0;
+ done:
+    if (fp)
+        fclose(fp);
+    return retval;
+}
+
+/*
+ * Merkle subtree hashes
+ * The hash of a node is FNV-1a of its name, module, body and the hashes of its element
+ * children in order. Children of bound trees are sorted in YANG order, so equal
+ * subtrees have equal hashes. Hashes of non-leaf nodes are kept in a map from node to
+ * hash, and the diff skips matched subtrees with equal hashes.
+ * The hashes of a baseline tree can be exported to a file, one line per non-leaf node
+ * in pre-order: "<hash> <api-path>", after a header with size, content digest and node
+ * count of the baseline file. A later diff against a baseline file with the same
+ * content imports the hashes instead of computing them. The digest is FNV-1a of the
+ * file bytes: reading the file is far cheaper than hashing the tree, and unlike mtime
+ * it does not miss rewrites within the same second or files copied with their mtime.
+ */
+#define FNV1A_OFFSET 0xcbf29ce484222325ULL
+#define FNV1A_PRIME  0x100000001b3ULL
+
+/*! Map from node to hash, open addressing with linear probing
+ */
+struct diff_hmap {
+    cxobj   **hm_keys;
+    uint64_t *hm_vals;
+    size_t    hm_size;  /* Power of 2 */
+    size_t    hm_n;
+};
+
+static uint64_t
+fnv1a(uint64_t    hash,
+      const void *buf,
+      size_t      len)
+{
+    const unsigned char *p = buf;
+    size_t               i;
+
+    for (i=0; i<len; i++){
+        hash ^= p[i];
+        hash *= FNV1A_PRIME;
+    }
+    return hash;
+}
+
+static size_t
+hmap_slot(struct diff_hmap *hm,
+          cxobj            *x)
+{
+    return (size_t)((((uintptr_t)x >> 4) * 0x9e3779b97f4a7c15ULL) >> 16) & (hm->hm_size-1);
+}
+
+static void
+hmap_free(struct diff_hmap *hm)
+{
+    if (hm->hm_keys)
+        free(hm->hm_keys);
+    if (hm->hm_vals)
+        free(hm->hm_vals);
+    memset(hm, 0, sizeof(*hm));
+}
+
+/*! Remove all entries, keep allocated size
+ */
+static void
+hmap_clear(struct diff_hmap *hm)
+{
+    if (hm->hm_size)
+        memset(hm->hm_keys, 0, hm->hm_size*sizeof(cxobj*));
+    hm->hm_n = 0;
+}
+
+static int
+hmap_get(struct diff_hmap *hm,
+         cxobj            *x,
+         uint64_t         *hash)
+{
+    size_t i;
+
+    if (hm->hm_size == 0)
+        return 0;
+    for (i = hmap_slot(hm, x); hm->hm_keys[i] != NULL; i = (i+1) & (hm->hm_size-1))
+        if (hm->hm_keys[i] == x){
+            *hash = hm->hm_vals[i];
+            return 1;
+        }
+    return 0;
+}
+
+static int
+hmap_put(struct diff_hmap *hm,
+         cxobj            *x,
+         uint64_t          hash)
+{
+    struct diff_hmap hm1 = {0,};
+    size_t           i;
+
+    if (2*(hm->hm_n+1) > hm->hm_size){ /* Grow */
+        hm1.hm_size = hm->hm_size ? 2*hm->hm_size : 1024;
+        if ((hm1.hm_keys = calloc(hm1.hm_size, sizeof(cxobj*))) == NULL ||
+            (hm1.hm_vals = calloc(hm1.hm_size, sizeof(uint64_t))) == NULL){
+            clixon_err(OE_UNIX, errno, "calloc");
+            hmap_free(&hm1);
+            return -1;
+        }
+        for (i=0; i<hm->hm_size; i++)
+            if (hm->hm_keys[i] && hmap_put(&hm1, hm->hm_keys[i], hm->hm_vals[i]) < 0){
+                hmap_free(&hm1);
+                return -1;
+            }
+        hmap_free(hm);
+        *hm = hm1;
+    }
+    for (i = hmap_slot(hm, x); hm->hm_keys[i] != NULL; i = (i+1) & (hm->hm_size-1))
+        if (hm->hm_keys[i] == x){
+            hm->hm_vals[i] = hash;
+            return 0;
+        }
+    hm->hm_keys[i] = x;
+    hm->hm_vals[i] = hash;
+    hm->hm_n++;
+    return 0;
+}
+
+/*! Compute Merkle hash of a subtree, store hashes of non-leaf nodes in map
+ *
+ * Nodes already in the map, eg imported, are not recomputed
+ * @param[in]  hm    Hash map
+ * @param[in]  x     Subtree
+ * @param[out] hash  Hash of x
+ */
+static int
+diff_hash(struct diff_hmap *hm,
+          cxobj            *x,
+          uint64_t         *hash)
+{
+    uint64_t   h;
+    uint64_t   hc;
+    cxobj     *xc;
+    yang_stmt *ym;
+    char      *str;
+    int        leaf = 1;
+
+    if (hmap_get(hm, x, hash))
+        return 0;
+    h = fnv1a(FNV1A_OFFSET, xml_name(x), strlen(xml_name(x))+1);
+    if (xml_spec(x) && (ym = ys_module(xml_spec(x))) != NULL){
+        str = yang_argument_get(ym);
+        h = fnv1a(h, str, strlen(str)+1);
+    }
+    if ((str = xml_body(x)) != NULL)
+        h = fnv1a(h, str, strlen(str)+1);
+    xc = NULL;
+    while ((xc = xml_child_each(x, xc, CX_ELMNT)) != NULL){
+        if (diff_hash(hm, xc, &hc) < 0)
+            return -1;
+        h = fnv1a(h, &hc, sizeof(hc));
+        leaf = 0;
+    }
+    if (!leaf && hmap_put(hm, x, h) < 0)
+        return -1;
+    *hash = h;
+    return 0;
+}
+
+/*! Get content digest of a file, FNV-1a of its bytes
+ *
+ * @param[in]  filename  File
+ * @param[out] digest    Digest
+ * @param[out] size      File size
+ */
+static int
+diff_file_digest(char     *filename,
+                 uint64_t *digest,
+                 uint64_t *size)
+{
+    int    retval = -1;
+    FILE  *f = NULL;
+    char   buf[65536];
+    size_t n;
+
+    if ((f = fopen(filename, "r")) == NULL){
+        clixon_err(OE_UNIX, errno, "fopen(%s)", filename);
+        goto done;
+    }
+    *digest = FNV1A_OFFSET;
+    *size = 0;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0){
+        *digest = fnv1a(*digest, buf, n);
+        *size += n;
+    }
+    if (ferror(f)){
+        clixon_err(OE_UNIX, errno, "fread(%s)", filename);
+        goto done;
+    }
+    retval = 0;
+ done:
+    if (f)
+        fclose(f);
+    return retval;
+}
+
+/*! Write hashes of non-leaf nodes of a tree in pre-order
+ */
+static int
+diff_hash_export_tree(FILE             *f,
+                      struct diff_hmap *hm,
+                      cxobj            *x,
+                      cbuf             *cb)
+{
+    cxobj   *xc;
+    uint64_t h;
+
+    if (!hmap_get(hm, x, &h))
+        return 0;
+    if (xml_parent(x) != NULL){ /* Not top */
+        cbuf_reset(cb);
+        if (xml2api_path_1(x, cb) < 0)
+            return -1;
+        fprintf(f, "%016" PRIx64 " %s\n", h, cbuf_get(cb));
+    }
+    else
+        fprintf(f, "%016" PRIx64 " /\n", h);
+    xc = NULL;
+    while ((xc = xml_child_each(x, xc, CX_ELMNT)) != NULL)
+        if (diff_hash_export_tree(f, hm, xc, cb) < 0)
+            return -1;
+    return 0;
+}
+
+/*! Count non-leaf nodes of a tree
+ */
+static int
+diff_hash_nodes(cxobj *x)
+{
+    cxobj *xc;
+    int    n = 0;
+
+    xc = NULL;
+    while ((xc = xml_child_each(x, xc, CX_ELMNT)) != NULL)
+        n += diff_hash_nodes(xc);
+    if (n == 0 && xml_child_nr_type(x, CX_ELMNT) == 0)
+        return 0;
+    return n + 1;
+}
+
+/*! Export hashes of a baseline tree to a file
+ *
+ * @param[in]  hashfile  Hash file
+ * @param[in]  filename  Baseline file the tree was parsed from
+ * @param[in]  hm        Hash map with hashes of tree
+ * @param[in]  xt        Baseline tree
+ */
+static int
+diff_hash_export(char             *hashfile,
+                 char             *filename,
+                 struct diff_hmap *hm,
+                 cxobj            *xt)
+{
+    int      retval = -1;
+    FILE    *f = NULL;
+    cbuf    *cb = NULL;
+    uint64_t digest;
+    uint64_t size;
+
+    if (diff_file_digest(filename, &digest, &size) < 0)
+        goto done;
+    if ((cb = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    if ((f = fopen(hashfile, "w")) == NULL){
+        clixon_err(OE_UNIX, errno, "fopen(%s)", hashfile);
+        goto done;
+    }
+    fprintf(f, "merkle %" PRIu64 " %016" PRIx64 " %d\n", size, digest, diff_hash_nodes(xt));
+    if (diff_hash_export_tree(f, hm, xt, cb) < 0)
+        goto done;
+    retval = 0;
+ done:
+    if (f)
+        fclose(f);
+    if (cb)
+        cbuf_free(cb);
+    return retval;
+}
+
+/*! Read hashes of non-leaf nodes of a tree in pre-order
+ */
+static int
+diff_hash_import_tree(FILE             *f,
+                      struct diff_hmap *hm,
+                      cxobj            *x)
+{
+    cxobj   *xc;
+    uint64_t h;
+
+    if (xml_child_nr_type(x, CX_ELMNT) == 0)
+        return 1;
+    if (fscanf(f, "%" SCNx64 " %*[^\n]\n", &h) != 1)
+        return 0;
+    if (hmap_put(hm, x, h) < 0)
+        return -1;
+    xc = NULL;
+    while ((xc = xml_child_each(x, xc, CX_ELMNT)) != NULL)
+        switch (diff_hash_import_tree(f, hm, xc)){
+        case -1:
+            return -1;
+        case 0:
+            return 0;
+        }
+    return 1;
+}
+
+/*! Import hashes of a baseline tree from a file, if it matches the baseline file
+ *
+ * @param[in]  hashfile  Hash file
+ * @param[in]  filename  Baseline file the tree was parsed from
+ * @param[in]  hm        Hash map, hashes of tree are added
+ * @param[in]  xt        Baseline tree
+ * @retval     1         Imported
+ * @retval     0         No hash file, or it does not match the baseline file
+ * @retval    -1         Error
+ */
+static int
+diff_hash_import(char             *hashfile,
+                 char             *filename,
+                 struct diff_hmap *hm,
+                 cxobj            *xt)
+{
+    int      retval = -1;
+    FILE    *f = NULL;
+    uint64_t size;
+    uint64_t digest;
+    uint64_t size0;
+    uint64_t digest0;
+    int      nr;
+    int      ret;
+
+    if ((f = fopen(hashfile, "r")) == NULL ||
+        fscanf(f, "merkle %" SCNu64 " %" SCNx64 " %d\n", &size0, &digest0, &nr) != 3){
+        retval = 0;
+        goto done;
+    }
+    if (diff_file_digest(filename, &digest, &size) < 0)
+        goto done;
+    if (size != size0 || digest != digest0 || nr != diff_hash_nodes(xt)){
+        retval = 0;
+        goto done;
+    }
+    if ((ret = diff_hash_import_tree(f, hm, xt)) < 0)
+        goto done;
+    if (ret == 0){ /* Truncated */
+        hmap_free(hm);
+        retval = 0;
+        goto done;
+    }
+    retval = 1;
+ done:
+    if (f)
+        fclose(f);
+    return retval;
+}
+
+/*
+ * Keyed tree diff
+ * Children of two matched nodes are matched by name, and for lists by key values and
+ * for leaf-lists by value, using the YANG spec. Unmatched children of x0 are deleted,
+ * unmatched children of x1 are added, and matched leaves with different values are
+ * changed. Each difference is reported to a callback of the diff context.
+ * Children of YANG-bound trees are sorted (see xml_sort), so they are matched by a
+ * merge-join of the two child vectors in O(n). Entries of ordered-by user lists are
+ * matched by a longest common subsequence in O(n log n), entries out of sequence are
+ * moved.
+ * Unsorted or unbound children fall back to a search per child via match_base_child.
+ */
+enum diff_op {
+    DIFF_ADD,    /* x1 node not in x0 */
+    DIFF_DEL,    /* x0 node not in x1 */
+    DIFF_CHANGE, /* Matched leaf (or anydata) with different value */
+    DIFF_MOVE    /* Ordered-by user entry moved, x1 entry replaces x0 entry */
+};
+
+/* YANG XML namespace of insert, key and value attributes (RFC 7950 7.8.6) */
+#ifndef YANG_XML_NAMESPACE
+#define YANG_XML_NAMESPACE "urn:ietf:params:xml:ns:yang:1"
+#endif
+
+struct diff_ctx;
+
+/*! Diff callback
+ *
+ * @param[in]  dc   Diff context, path of x1 parents in dc_path
+ * @param[in]  op   Difference
+ * @param[in]  x0   Node in x0, or NULL if added
+ * @param[in]  x1   Node in x1, or NULL if deleted
+ */
+typedef int (diff_fn_t)(struct diff_ctx *dc, enum diff_op op, cxobj *x0, cxobj *x1);
+
+/*! Diff context
+ */
+struct diff_ctx {
+    diff_fn_t *dc_fn;      /* Callback of each difference */
+    cxobj     *dc_xout;    /* Edit-config tree, built by diff_edit_cb */
+    cxobj    **dc_path;    /* x1 parents from top to current node */
+    cxobj    **dc_out;     /* Copies of dc_path in dc_xout, NULL until needed */
+    int        dc_depth;   /* Length of dc_path */
+    int        dc_len;     /* Allocated length of dc_path and dc_out */
+    int        dc_match;   /* Always search per child, do not merge-join */
+    struct diff_hmap *dc_hash;    /* Merkle hashes of x0 and x1, or NULL */
+    struct diff_hmap *dc_hash1;   /* Merkle hashes of x1 if not in dc_hash, or NULL */
+    int        dc_skipped; /* Subtrees skipped by equal hashes */
+    int        dc_adds;
+    int        dc_dels;
+    int        dc_changes;
+    int        dc_moves;
+    void      *dc_arg;     /* Callback argument */
+};
+
+static int
+diff_push(struct diff_ctx *dc,
+          cxobj           *x1)
+{
+    if (dc->dc_depth == dc->dc_len){
+        dc->dc_len = dc->dc_len ? 2*dc->dc_len : 16;
+        if ((dc->dc_path = realloc(dc->dc_path, dc->dc_len*sizeof(cxobj*))) == NULL ||
+            (dc->dc_out = realloc(dc->dc_out, dc->dc_len*sizeof(cxobj*))) == NULL){
+            clixon_err(OE_UNIX, errno, "realloc");
+            return -1;
+        }
+    }
+    dc->dc_path[dc->dc_depth] = x1;
+    dc->dc_out[dc->dc_depth] = NULL;
+    dc->dc_depth++;
+    return 0;
+}
+
+static int
+diff_emit(struct diff_ctx *dc,
+          enum diff_op     op,
+          cxobj           *x0,
+          cxobj           *x1)
+{
+    switch (op){
+    case DIFF_ADD:
+        dc->dc_adds++;
+        break;
+    case DIFF_DEL:
+        dc->dc_dels++;
+        break;
+    case DIFF_CHANGE:
+        dc->dc_changes++;
+        break;
+    case DIFF_MOVE:
+        dc->dc_moves++;
+        break;
+    }
+    if (dc->dc_fn)
+        return dc->dc_fn(dc, op, x0, x1);
+    return 0;
+}
+
+static int diff_children(struct diff_ctx *dc, cxobj *x0, cxobj *x1);
+
+/*! Compare two matched nodes
+ */
+static int
+diff_node(struct diff_ctx *dc,
+          cxobj           *x0,
+          cxobj           *x1)
+{
+    yang_stmt *y;
+    char      *b0;
+    char      *b1;
+    uint64_t   h0;
+    uint64_t   h1;
+    int        leaf;
+
+    y = xml_spec(x1);
+    if (y != NULL)
+        leaf = yang_keyword_get(y) == Y_LEAF || yang_keyword_get(y) == Y_LEAF_LIST;
+    else
+        leaf = xml_child_nr_type(x0, CX_ELMNT) == 0 && xml_child_nr_type(x1, CX_ELMNT) == 0;
+    if (leaf){
+        b0 = xml_body(x0);
+        b1 = xml_body(x1);
+        if (strcmp(b0?b0:"", b1?b1:"") != 0)
+            return diff_emit(dc, DIFF_CHANGE, x0, x1);
+        return 0;
+    }
+    if (y != NULL &&
+        (yang_keyword_get(y) == Y_ANYDATA || yang_keyword_get(y) == Y_ANYXML)){
+        if (xml_tree_equal(x0, x1) != 0)
+            return diff_emit(dc, DIFF_CHANGE, x0, x1);
+        return 0;
+    }
+    if (dc->dc_hash &&
+        hmap_get(dc->dc_hash, x0, &h0) &&
+        hmap_get(dc->dc_hash1 ? dc->dc_hash1 : dc->dc_hash, x1, &h1) && h0 == h1){
+        dc->dc_skipped++;
+        return 0;
+    }
+    if (diff_push(dc, x1) < 0)
+        return -1;
+    if (diff_children(dc, x0, x1) < 0)
+        return -1;
+    dc->dc_depth--;
+    return 0;
+}
+
+/*! Diff children of two matched nodes, search a match of each x1 child
+ */
+static int
+diff_children_match(struct diff_ctx *dc,
+                    cxobj           *x0,
+                    cxobj           *x1)
+{
+    cxobj     *x0c;
+    cxobj     *x1c;
+    yang_stmt *yc;
+
+    x1c = NULL;
+    while ((x1c = xml_child_each(x1, x1c, CX_ELMNT)) != NULL){
+        x0c = NULL;
+        if ((yc = xml_spec(x1c)) == NULL)
+            x0c = xml_find_type(x0, xml_prefix(x1c), xml_name(x1c), CX_ELMNT);
+        else if (match_base_child(x0, x1c, yc, &x0c) < 0)
+            return -1;
+        if (x0c == NULL){
+            if (diff_emit(dc, DIFF_ADD, NULL, x1c) < 0)
+                return -1;
+            continue;
+        }
+        xml_flag_set(x0c, XML_FLAG_MARK);
+        if (diff_node(dc, x0c, x1c) < 0)
+            return -1;
+    }
+    x0c = NULL;
+    while ((x0c = xml_child_each(x0, x0c, CX_ELMNT)) != NULL){
+        if (xml_flag(x0c, XML_FLAG_MARK))
+            xml_flag_reset(x0c, XML_FLAG_MARK);
+        else if (diff_emit(dc, DIFF_DEL, x0c, NULL) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/*! Check if a node is an entry of an ordered-by user list or leaf-list
+ */
+static int
+diff_user_ordered(yang_stmt *y)
+{
+    return y != NULL &&
+        (yang_keyword_get(y) == Y_LIST || yang_keyword_get(y) == Y_LEAF_LIST) &&
+        yang_find(y, Y_ORDERED_BY, "user") != NULL;
+}
+
+/*! Check if two entries of the same list or leaf-list have equal keys or values
+ */
+static int
+diff_key_eq(cxobj *x0,
+            cxobj *x1)
+{
+    yang_stmt *y = xml_spec(x1);
+    cg_var    *cvi;
+    char      *b0;
+    char      *b1;
+
+    if (yang_keyword_get(y) == Y_LEAF_LIST){
+        b0 = xml_body(x0);
+        b1 = xml_body(x1);
+        return strcmp(b0?b0:"", b1?b1:"") == 0;
+    }
+    cvi = NULL;
+    while ((cvi = cvec_each(yang_cvec_get(y), cvi)) != NULL){
+        b0 = xml_find_body(x0, cv_string_get(cvi));
+        b1 = xml_find_body(x1, cv_string_get(cvi));
+        if (strcmp(b0?b0:"", b1?b1:"") != 0)
+            return 0;
+    }
+    return 1;
+}
+
+/*! Get element children of a node as a vector, and check they are bound and sorted
+ *
+ * @param[in]  x      XML node
+ * @param[out] vecp   Malloced vector of element children, free with free
+ * @param[out] lenp   Length of vector
+ * @retval     1      Bound and sorted
+ * @retval     0      Not bound or not sorted
+ * @retval    -1      Error
+ */
+static int
+diff_child_vec(cxobj   *x,
+               cxobj ***vecp,
+               int     *lenp)
+{
+    cxobj  **vec;
+    cxobj   *xc;
+    int      len = 0;
+    int      sorted = 1;
+    int      i;
+
+    if ((vec = malloc((xml_child_nr(x)+1)*sizeof(cxobj*))) == NULL){
+        clixon_err(OE_UNIX, errno, "malloc");
+        return -1;
+    }
+    for (i=0; i<xml_child_nr(x); i++){
+        xc = xml_child_i(x, i);
+        if (xml_type(xc) != CX_ELMNT)
+            continue;
+        if (xml_spec(xc) == NULL)
+            sorted = 0;
+        else if (sorted && len &&
+                 !(xml_spec(xc) == xml_spec(vec[len-1]) && diff_user_ordered(xml_spec(xc))) &&
+                 xml_cmp(vec[len-1], xc, 0, 0, NULL) > 0)
+            sorted = 0;
+        vec[len++] = xc;
+    }
+    *vecp = vec;
+    *lenp = len;
+    return sorted;
+}
+
+/*! Hash of the keys of a list entry, or of the value of a leaf-list entry
+ *
+ * Entries with equal keys according to diff_key_eq have equal hashes
+ */
+static uint64_t
+diff_key_hash(cxobj *x)
+{
+    yang_stmt *y = xml_spec(x);
+    cg_var    *cvi;
+    char      *b;
+    uint64_t   h = FNV1A_OFFSET;
+
+    if (yang_keyword_get(y) == Y_LEAF_LIST){
+        b = xml_body(x);
+        return fnv1a(h, b?b:"", b?strlen(b)+1:1);
+    }
+    cvi = NULL;
+    while ((cvi = cvec_each(yang_cvec_get(y), cvi)) != NULL){
+        b = xml_find_body(x, cv_string_get(cvi));
+        h = fnv1a(h, b?b:"", b?strlen(b)+1:1);
+    }
+    return h;
+}
+
+/*! Diff two runs of entries of the same ordered-by user list or leaf-list
+ *
+ * Each x1 entry is matched to an x0 entry with equal key via a hash table. Since keys
+ * are unique, the longest common subsequence of the two runs is the longest increasing
+ * subsequence of the x0 positions of matched x1 entries, found in O(n log n) by
+ * patience sorting. Entries in it are matched in place. Other entries present in
+ * both are moved, the rest are added or deleted.
+ */
+static int
+diff_lcs(struct diff_ctx *dc,
+         cxobj          **v0,
+         int              n0,
+         cxobj          **v1,
+         int              n1)
+{
+    int       retval = -1;
+    int      *tab = NULL;  /* Hash table of x0 positions, -1 if empty */
+    uint64_t *h0 = NULL;   /* Key hash of each x0 entry */
+    char     *used = NULL; /* x0 entry is matched */
+    int      *p = NULL;    /* x0 position matched to each x1 entry, or -1 */
+    int      *tail = NULL; /* x1 index ending an increasing run of each length */
+    int      *prev = NULL; /* x1 index before each x1 entry in its run, or -1 */
+    char     *inseq = NULL;/* x1 entry is in the longest increasing run */
+    size_t    size = 2;
+    size_t    k;
+    uint64_t  h;
+    int       len = 0;
+    int       lo;
+    int       hi;
+    int       mid;
+    int       i;
+    int       j;
+
+    while (size < 2*(size_t)n0)
+        size *= 2;
+    if ((tab = malloc(size*sizeof(int))) == NULL ||
+        (h0 = calloc(n0+1, sizeof(uint64_t))) == NULL ||
+        (used = calloc(n0+1, 1)) == NULL ||
+        (p = calloc(n1+1, sizeof(int))) == NULL ||
+        (tail = calloc(n1+1, sizeof(int))) == NULL ||
+        (prev = calloc(n1+1, sizeof(int))) == NULL ||
+        (inseq = calloc(n1+1, 1)) == NULL){
+        clixon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    memset(tab, 0xff, size*sizeof(int));
+    for (i=0; i<n0; i++){
+        h0[i] = diff_key_hash(v0[i]);
+        for (k=h0[i] & (size-1); tab[k] != -1; k=(k+1) & (size-1));
+        tab[k] = i;
+    }
+    /* Match each x1 entry to the first unmatched x0 entry with equal key */
+    for (j=0; j<n1; j++){
+        p[j] = -1;
+        h = diff_key_hash(v1[j]);
+        for (k=h & (size-1); (i = tab[k]) != -1; k=(k+1) & (size-1))
+            if (!used[i] && h0[i] == h && diff_key_eq(v0[i], v1[j])){
+                used[i] = 1;
+                p[j] = i;
+                break;
+            }
+    }
+    /* Longest increasing subsequence of p */
+    for (j=0; j<n1; j++){
+        if (p[j] < 0)
+            continue;
+        lo = 0;
+        hi = len;
+        while (lo < hi){
+            mid = (lo+hi)/2;
+            if (p[tail[mid]] < p[j])
+                lo = mid+1;
+            else
+                hi = mid;
+        }
+        prev[j] = lo ? tail[lo-1] : -1;
+        tail[lo] = j;
+        if (lo == len)
+            len++;
+    }
+    for (j = len ? tail[len-1] : -1; j >= 0; j = prev[j])
+        inseq[j] = 1;
+    for (j=0; j<n1; j++){
+        if (inseq[j]){
+            if (diff_node(dc, v0[p[j]], v1[j]) < 0)
+                goto done;
+        }
+        else if (p[j] >= 0){
+            if (diff_emit(dc, DIFF_MOVE, v0[p[j]], v1[j]) < 0)
+                goto done;
+        }
+        else if (diff_emit(dc, DIFF_ADD, NULL, v1[j]) < 0)
+            goto done;
+    }
+    for (i=0; i<n0; i++)
+        if (!used[i] && diff_emit(dc, DIFF_DEL, v0[i], NULL) < 0)
+            goto done;
+    retval = 0;
+ done:
+    if (inseq)
+        free(inseq);
+    if (prev)
+        free(prev);
+    if (tail)
+        free(tail);
+    if (p)
+        free(p);
+    if (used)
+        free(used);
+    if (h0)
+        free(h0);
+    if (tab)
+        free(tab);
+    return retval;
+}
+
+/*! Diff children of two matched nodes by a merge-join of their sorted children
+ *
+ * @retval  1   OK
+ * @retval  0   Children not bound or not sorted, nothing done
+ * @retval -1   Error
+ */
+static int
+diff_children_merge(struct diff_ctx *dc,
+                    cxobj           *x0,
+                    cxobj           *x1)
+{
+    int        retval = -1;
+    cxobj    **v0 = NULL;
+    cxobj    **v1 = NULL;
+    int        n0;
+    int        n1;
+    int        i = 0;
+    int        j = 0;
+    int        i2;
+    int        j2;
+    yang_stmt *y;
+    int        c;
+    int        ret;
+
+    if ((ret = diff_child_vec(x0, &v0, &n0)) < 0)
+        goto done;
+    if (ret == 1 && (ret = diff_child_vec(x1, &v1, &n1)) < 0)
+        goto done;
+    if (ret == 0){
+        retval = 0;
+        goto done;
+    }
+    while (i < n0 || j < n1){
+        if (i == n0){
+            if (diff_emit(dc, DIFF_ADD, NULL, v1[j++]) < 0)
+                goto done;
+            continue;
+        }
+        if (j == n1){
+            if (diff_emit(dc, DIFF_DEL, v0[i++], NULL) < 0)
+                goto done;
+            continue;
+        }
+        y = xml_spec(v1[j]);
+        if (xml_spec(v0[i]) == y && diff_user_ordered(y)){
+            for (i2=i; i2<n0 && xml_spec(v0[i2]) == y; i2++);
+            for (j2=j; j2<n1 && xml_spec(v1[j2]) == y; j2++);
+            if (diff_lcs(dc, v0+i, i2-i, v1+j, j2-j) < 0)
+                goto done;
+            i = i2;
+            j = j2;
+            continue;
+        }
+        c = xml_cmp(v0[i], v1[j], 0, 0, NULL);
+        if (c < 0)
+            ret = diff_emit(dc, DIFF_DEL, v0[i++], NULL);
+        else if (c > 0)
+            ret = diff_emit(dc, DIFF_ADD, NULL, v1[j++]);
+        else
+            ret = diff_node(dc, v0[i++], v1[j++]);
+        if (ret < 0)
+            goto done;
+    }
+    retval = 1;
+ done:
+    if (v0)
+        free(v0);
+    if (v1)
+        free(v1);
+    return retval;
+}
+
+/*! Diff children of two matched nodes
+ */
+static int
+diff_children(struct diff_ctx *dc,
+              cxobj           *x0,
+              cxobj           *x1)
+{
+    int ret;
+
+    if (!dc->dc_match){
+        if ((ret = diff_children_merge(dc, x0, x1)) < 0)
+            return -1;
+        if (ret == 1)
+            return 0;
+    }
+    return diff_children_match(dc, x0, x1);
+}
+
+/*! Diff two trees, calling the callback of the context for each difference
+ *
+ * @param[in]  dc   Diff context
+ * @param[in]  x0   Original tree
+ * @param[in]  x1   New tree
+ */
+static int
+xml_diff(struct diff_ctx *dc,
+         cxobj           *x0,
+         cxobj           *x1)
+{
+    dc->dc_depth = 0;
+    if (diff_push(dc, x1) < 0)
+        return -1;
+    dc->dc_out[0] = dc->dc_xout;
+    return diff_children(dc, x0, x1);
+}
+
+/*
+ * Parallel diff (-j)
+ * Top-level children are matched by the calling thread, and each matched pair, added
+ * or deleted top-level node is a task. Tasks are run by a pool of worker threads,
+ * each task with its own diff context. Workers do not call the callback, since
+ * callbacks build XML with libclixon, which is not thread-safe. They only record
+ * each difference with its x1 parent. In the merge phase the calling thread replays
+ * the records in task order through the callback.
+ * Workers do not only read: they set and reset XML_FLAG_MARK on children of the
+ * subtrees they diff, and xml_child_each keeps its position in the parent. Both are
+ * safe since the subtrees of tasks are disjoint. The shared Merkle hashes are only
+ * read.
+ * The edits are the same as from a sequential diff. Only the order of top-level
+ * nodes may differ: deleted top-level nodes come after the others.
+ */
+
+/*! A difference recorded by a worker
+ */
+struct diff_rec {
+    enum diff_op dr_op;
+    cxobj       *dr_x0;
+    cxobj       *dr_x1;
+    cxobj       *dr_parent; /* x1 parent, top of dc_path when recorded */
+};
+
+/*! Diff task of a top-level node
+ */
+struct diff_task {
+    enum diff_op     dt_op;    /* DIFF_ADD, DIFF_DEL or DIFF_CHANGE for matched pair */
+    cxobj           *dt_x0;
+    cxobj           *dt_x1;
+    struct diff_ctx  dt_dc;    /* Diff context and counts of task */
+    struct diff_rec *dt_recs;  /* Recorded differences */
+    int              dt_nrecs;
+    int              dt_len;   /* Allocated length of dt_recs */
+    int              dt_err;   /* Task failed */
+};
+
+/*! Worker pool state
+ */
+struct diff_pool {
+    struct diff_task *dp_tasks;
+    int               dp_n;
+    int               dp_next;   /* Next task to run */
+    pthread_mutex_t   dp_mutex;
+    cxobj            *dp_x1;     /* x1 top */
+};
+
+/*! Worker callback: record a difference of a task
+ */
+static int
+diff_record_cb(struct diff_ctx *dc,
+               enum diff_op     op,
+               cxobj           *x0,
+               cxobj           *x1)
+{
+    struct diff_task *dt = (struct diff_task *)dc->dc_arg;
+    struct diff_rec  *dr;
+
+    if (dt->dt_nrecs == dt->dt_len){
+        dt->dt_len = dt->dt_len ? 2*dt->dt_len : 64;
+        if ((dt->dt_recs = realloc(dt->dt_recs, dt->dt_len*sizeof(*dr))) == NULL)
+            return -1;
+    }
+    dr = &dt->dt_recs[dt->dt_nrecs++];
+    dr->dr_op = op;
+    dr->dr_x0 = x0;
+    dr->dr_x1 = x1;
+    dr->dr_parent = dc->dc_path[dc->dc_depth-1];
+    return 0;
+}
+
+static void *
+diff_worker(void *arg)
+{
+    struct diff_pool *dp = (struct diff_pool *)arg;
+    struct diff_task *dt;
+    struct diff_ctx  *dc;
+    int               i;
+
+    while (1){
+        pthread_mutex_lock(&dp->dp_mutex);
+        i = dp->dp_next++;
+        pthread_mutex_unlock(&dp->dp_mutex);
+        if (i >= dp->dp_n)
+            break;
+        dt = &dp->dp_tasks[i];
+        dc = &dt->dt_dc;
+        if (diff_push(dc, dp->dp_x1) < 0)
+            dt->dt_err = 1;
+        else if (dt->dt_op == DIFF_CHANGE){
+            if (diff_node(dc, dt->dt_x0, dt->dt_x1) < 0)
+                dt->dt_err = 1;
+        }
+        else if (diff_emit(dc, dt->dt_op, dt->dt_x0, dt->dt_x1) < 0)
+            dt->dt_err = 1;
+    }
+    return NULL;
+}
+
+/*! Replay the recorded differences of a task through the callback of a diff context
+ *
+ * dc_path is set to the x1 parents of each difference. Its common prefix with the
+ * previous difference is kept, with the edit-config nodes already created for it.
+ * @param[in]  dc   Diff context, x1 top in dc_path[0]
+ * @param[in]  dt   Task
+ * @param[in,out] ancp  Scratch vector of parents
+ * @param[in,out] lenp  Allocated length of ancp
+ */
+static int
+diff_replay(struct diff_ctx  *dc,
+            struct diff_task *dt,
+            cxobj          ***ancp,
+            int              *lenp)
+{
+    struct diff_rec *dr;
+    cxobj           *xp;
+    int              depth;
+    int              i;
+    int              k;
+
+    for (i=0; i<dt->dt_nrecs; i++){
+        dr = &dt->dt_recs[i];
+        depth = 0;
+        for (xp = dr->dr_parent; xp != dc->dc_path[0]; xp = xml_parent(xp))
+            depth++;
+        if (depth+1 > *lenp){
+            *lenp = depth+1;
+            if ((*ancp = realloc(*ancp, *lenp*sizeof(cxobj*))) == NULL){
+                clixon_err(OE_UNIX, errno, "realloc");
+                return -1;
+            }
+        }
+        for (xp = dr->dr_parent, k=depth; k>=0; xp = xml_parent(xp), k--)
+            (*ancp)[k] = xp;
+        for (k=1; k<dc->dc_depth && k<=depth && dc->dc_path[k] == (*ancp)[k]; k++);
+        dc->dc_depth = k;
+        for (; k<=depth; k++)
+            if (diff_push(dc, (*ancp)[k]) < 0)
+                return -1;
+        if (dc->dc_fn(dc, dr->dr_op, dr->dr_x0, dr->dr_x1) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/*! Diff two trees with top-level children diffed in parallel
+ *
+ * @param[in]  dc       Diff context: callback, output tree and options. Counts are added
+ * @param[in]  x0       Original tree
+ * @param[in]  x1       New tree
+ * @param[in]  workers  Number of worker threads
+ */
+static int
+xml_diff_parallel(struct diff_ctx *dc,
+                  cxobj           *x0,
+                  cxobj           *x1,
+                  int              workers)
+{
+    int               retval = -1;
+    struct diff_pool  dp = {0,};
+    struct diff_task *dt;
+    pthread_t        *tids = NULL;
+    int               started = 0;
+    cxobj            *x0c;
+    cxobj            *x1c;
+    cxobj           **anc = NULL;
+    int               anclen = 0;
+    yang_stmt        *yc;
+    int               i;
+
+    pthread_mutex_init(&dp.dp_mutex, NULL);
+    dp.dp_x1 = x1;
+    if ((dp.dp_tasks = calloc(xml_child_nr(x0) + xml_child_nr(x1) + 1, sizeof(*dt))) == NULL){
+        clixon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    /* Match top-level children */
+    x1c = NULL;
+    while ((x1c = xml_child_each(x1, x1c, CX_ELMNT)) != NULL){
+        x0c = NULL;
+        if ((yc = xml_spec(x1c)) == NULL)
+            x0c = xml_find_type(x0, xml_prefix(x1c), xml_name(x1c), CX_ELMNT);
+        else if (match_base_child(x0, x1c, yc, &x0c) < 0)
+            goto done;
+        dt = &dp.dp_tasks[dp.dp_n++];
+        dt->dt_op = x0c ? DIFF_CHANGE : DIFF_ADD;
+        dt->dt_x0 = x0c;
+        dt->dt_x1 = x1c;
+        if (x0c)
+            xml_flag_set(x0c, XML_FLAG_MARK);
+    }
+    x0c = NULL;
+    while ((x0c = xml_child_each(x0, x0c, CX_ELMNT)) != NULL){
+        if (xml_flag(x0c, XML_FLAG_MARK)){
+            xml_flag_reset(x0c, XML_FLAG_MARK);
+            continue;
+        }
+        dt = &dp.dp_tasks[dp.dp_n++];
+        dt->dt_op = DIFF_DEL;
+        dt->dt_x0 = x0c;
+    }
+    for (i=0; i<dp.dp_n; i++){
+        dt = &dp.dp_tasks[i];
+        if (dc->dc_fn)
+            dt->dt_dc.dc_fn = diff_record_cb;
+        dt->dt_dc.dc_arg = dt;
+        dt->dt_dc.dc_match = dc->dc_match;
+        dt->dt_dc.dc_hash = dc->dc_hash;
+        dt->dt_dc.dc_hash1 = dc->dc_hash1;
+    }
+    if ((tids = calloc(workers, sizeof(pthread_t))) == NULL){
+        clixon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    for (started=0; started<workers; started++)
+        if ((errno = pthread_create(&tids[started], NULL, diff_worker, &dp)) != 0){
+            clixon_err(OE_UNIX, errno, "pthread_create");
+            break;
+        }
+    for (i=0; i<started; i++)
+        pthread_join(tids[i], NULL);
+    if (started == 0)
+        goto done;
+    for (i=0; i<dp.dp_n; i++){
+        dt = &dp.dp_tasks[i];
+        if (dt->dt_err){
+            x1c = dt->dt_x1 ? dt->dt_x1 : dt->dt_x0;
+            clixon_err(OE_XML, 0, "Parallel diff of %s failed", xml_name(x1c));
+            goto done;
+        }
+    }
+    /* Merge: counts, and replay of differences in task order */
+    if (dc->dc_fn){
+        if (diff_push(dc, x1) < 0)
+            goto done;
+        dc->dc_out[0] = dc->dc_xout;
+    }
+    for (i=0; i<dp.dp_n; i++){
+        dt = &dp.dp_tasks[i];
+        dc->dc_adds += dt->dt_dc.dc_adds;
+        dc->dc_dels += dt->dt_dc.dc_dels;
+        dc->dc_changes += dt->dt_dc.dc_changes;
+        dc->dc_moves += dt->dt_dc.dc_moves;
+        dc->dc_skipped += dt->dt_dc.dc_skipped;
+        if (dc->dc_fn && diff_replay(dc, dt, &anc, &anclen) < 0)
+            goto done;
+    }
+    retval = 0;
+ done:
+    if (dp.dp_tasks){
+        for (i=0; i<dp.dp_n; i++){
+            dt = &dp.dp_tasks[i];
+            if (dt->dt_recs)
+                free(dt->dt_recs);
+            if (dt->dt_dc.dc_path)
+                free(dt->dt_dc.dc_path);
+            if (dt->dt_dc.dc_out)
+                free(dt->dt_dc.dc_out);
+        }
+        free(dp.dp_tasks);
+    }
+    if (anc)
+        free(anc);
+    if (tids)
+        free(tids);
+    pthread_mutex_destroy(&dp.dp_mutex);
+    return retval;
+}
+
+/*! Shallow copy of a node into the edit-config tree: namespace declarations and keys
+ */
+static cxobj *
+diff_out_node(cxobj *x,
+              cxobj *xp)
+{
+    cxobj     *xn;
+    cxobj     *xa;
+    cxobj     *xk;
+    yang_stmt *y;
+    cg_var    *cvi;
+
+    if ((xn = xml_new(xml_name(x), xp, CX_ELMNT)) == NULL)
+        return NULL;
+    if (xml_prefix(x) && xml_prefix_set(xn, xml_prefix(x)) < 0)
+        return NULL;
+    xml_spec_set(xn, xml_spec(x));
+    xa = NULL;
+    while ((xa = xml_child_each(x, xa, CX_ATTR)) != NULL){
+        if (xml_prefix(xa) ? strcmp(xml_prefix(xa), "xmlns") != 0 :
+            strcmp(xml_name(xa), "xmlns") != 0)
+            continue;
+        if ((xk = xml_dup(xa)) == NULL || xml_addsub(xn, xk) < 0)
+            return NULL;
+    }
+    if ((y = xml_spec(x)) != NULL && yang_keyword_get(y) == Y_LIST){
+        cvi = NULL;
+        while ((cvi = cvec_each(yang_cvec_get(y), cvi)) != NULL){
+            if ((xk = xml_find_type(x, NULL, cv_string_get(cvi), CX_ELMNT)) == NULL)
+                continue;
+            if ((xk = xml_dup(xk)) == NULL || xml_addsub(xn, xk) < 0)
+                return NULL;
+        }
+    }
+    return xn;
+}
+
+/*! Get parent in the edit-config tree of the current node, create path if needed
+ */
+static cxobj *
+diff_out_parent(struct diff_ctx *dc)
+{
+    int i;
+
+    for (i=1; i<dc->dc_depth; i++)
+        if (dc->dc_out[i] == NULL &&
+            (dc->dc_out[i] = diff_out_node(dc->dc_path[i], dc->dc_out[i-1])) == NULL)
+            return NULL;
+    return dc->dc_out[dc->dc_depth-1];
+}
+
+/*! Add insert attributes to an added or moved ordered-by user entry
+ *
+ * The entry is inserted after its preceding entry in x1, or first
+ * @param[in]  xn  Entry in edit-config
+ * @param[in]  x1  Entry in x1
+ */
+static int
+diff_out_insert(cxobj *xn,
+                cxobj *x1)
+{
+    int        retval = -1;
+    yang_stmt *y = xml_spec(x1);
+    cxobj     *xp = xml_parent(x1);
+    cxobj     *xprev = NULL;
+    cxobj     *xc;
+    cbuf      *cb = NULL;
+    cg_var    *cvi;
+    int        i;
+
+    if (!diff_user_ordered(y) || xp == NULL)
+        return 0;
+    for (i=0; i<xml_child_nr(xp); i++){
+        if ((xc = xml_child_i(xp, i)) == x1)
+            break;
+        if (xml_type(xc) == CX_ELMNT && xml_spec(xc) == y)
+            xprev = xc;
+    }
+    if (xprev == NULL){
+        if (xml_add_attr(xn, "insert", "first", "yang", NULL) == NULL)
+            goto done;
+        goto ok;
+    }
+    if (xml_add_attr(xn, "insert", "after", "yang", NULL) == NULL)
+        goto done;
+    if ((cb = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    if (yang_keyword_get(y) == Y_LEAF_LIST){
+        if (xml_add_attr(xn, "value", xml_body(xprev)?xml_body(xprev):"", "yang", NULL) == NULL)
+            goto done;
+        goto ok;
+    }
+    cvi = NULL;
+    while ((cvi = cvec_each(yang_cvec_get(y), cvi)) != NULL)
+        cprintf(cb, "[%s='%s']", cv_string_get(cvi),
+                xml_find_body(xprev, cv_string_get(cvi))?xml_find_body(xprev, cv_string_get(cvi)):"");
+    if (xml_add_attr(xn, "key", cbuf_get(cb), "yang", NULL) == NULL)
+        goto done;
+ ok:
+    retval = 0;
+ done:
+    if (cb)
+        cbuf_free(cb);
+    return retval;
+}
+
+/*! Diff callback building a NETCONF edit-config that transforms x0 into x1
+ *
+ * Added and changed nodes are merged, deleted nodes have operation delete and
+ * changed anydata has operation replace. Added and moved ordered-by user entries
+ * are positioned with insert attributes, a moved entry replaces the old entry.
+ */
+static int
+diff_edit_cb(struct diff_ctx *dc,
+             enum diff_op     op,
+             cxobj           *x0,
+             cxobj           *x1)
+{
+    cxobj     *xp;
+    cxobj     *xn;
+    cxobj     *xb;
+    yang_stmt *y;
+
+    if ((xp = diff_out_parent(dc)) == NULL)
+        return -1;
+    switch (op){
+    case DIFF_ADD:
+    case DIFF_CHANGE:
+    case DIFF_MOVE:
+        if ((xn = xml_dup(x1)) == NULL || xml_addsub(xp, xn) < 0)
+            return -1;
+        if (op != DIFF_CHANGE && diff_out_insert(xn, x1) < 0)
+            return -1;
+        if (op == DIFF_MOVE &&
+            xml_add_attr(xn, "operation", "replace", NETCONF_BASE_PREFIX, NULL) == NULL)
+            return -1;
+        y = xml_spec(x1);
+        if (op == DIFF_CHANGE && y &&
+            (yang_keyword_get(y) == Y_ANYDATA || yang_keyword_get(y) == Y_ANYXML) &&
+            xml_add_attr(xn, "operation", "replace", NETCONF_BASE_PREFIX, NULL) == NULL)
+            return -1;
+        break;
+    case DIFF_DEL:
+        if ((xn = diff_out_node(x0, xp)) == NULL)
+            return -1;
+        if ((y = xml_spec(x0)) != NULL && yang_keyword_get(y) == Y_LEAF_LIST &&
+            (xb = xml_body_get(x0)) != NULL){
+            if ((xb = xml_dup(xb)) == NULL || xml_addsub(xn, xb) < 0)
+                return -1;
+        }
+        if (xml_add_attr(xn, "operation", "delete", NETCONF_BASE_PREFIX, NULL) == NULL)
+            return -1;
+        break;
+    }
+    return 0;
+}
+
+/*! Print a tree in a format
+ */
+static int
+diff_tree_print(FILE            *f,
+                cxobj           *x,
+                enum format_enum format)
+{
+    switch (format){
+    case FORMAT_XML:
+        if (clixon_xml2file(f, x, 0, 1, NULL, fprintf, 0, 0) < 0)
+            return -1;
+        break;
+    case FORMAT_JSON:
+        if (clixon_json2file(f, x, 1, fprintf, 0, 0) < 0)
+            return -1;
+        break;
+    case FORMAT_TEXT:
+        if (clixon_text2file(f, x, 0, fprintf, 0, 0) < 0)
+            return -1;
+        break;
+    default:
+        clixon_err(OE_XML, 0, "Unsupported format");
+        return -1;
+    }
+    return 0;
+}
+
+/*! Print edit-config that transforms x0 into x1
+ *
+ * @param[in]  x0      Original tree
+ * @param[in]  x1      New tree
+ * @param[in]  format  Output format
+ * @param[in]  hm      Merkle hashes of x0 and x1, or NULL
+ * @param[in]  workers Number of worker threads, diff sequentially if 1
+ */
+static int
+diff_edit_print(cxobj            *x0,
+                cxobj            *x1,
+                enum format_enum  format,
+                struct diff_hmap *hm,
+                int               workers)
+{
+    int             retval = -1;
+    struct diff_ctx dc = {0,};
+
+    dc.dc_fn = diff_edit_cb;
+    dc.dc_hash = hm;
+    if ((dc.dc_xout = xml_new(NETCONF_INPUT_CONFIG, NULL, CX_ELMNT)) == NULL)
+        goto done;
+    if (xml_add_attr(dc.dc_xout, NETCONF_BASE_PREFIX, NETCONF_BASE_NAMESPACE, "xmlns", NULL) == NULL)
+        goto done;
+    if (xml_add_attr(dc.dc_xout, "yang", YANG_XML_NAMESPACE, "xmlns", NULL) == NULL)
+        goto done;
+    if (workers > 1){
+        if (xml_diff_parallel(&dc, x0, x1, workers) < 0)
+            goto done;
+    }
+    else if (xml_diff(&dc, x0, x1) < 0)
+        goto done;
+    if (diff_tree_print(stdout, dc.dc_xout, format) < 0)
+        goto done;
+    fprintf(stderr, "diff: add: %d delete: %d change: %d move: %d\n",
+            dc.dc_adds, dc.dc_dels, dc.dc_changes, dc.dc_moves);
+    retval = 0;
+ done:
+    if (dc.dc_path)
+        free(dc.dc_path);
+    if (dc.dc_out)
+        free(dc.dc_out);
+    if (dc.dc_xout)
+        xml_free(dc.dc_xout);
+    return retval;
+}
+
+/*
+ * Three-way merge (-f base -f candidate -f running)
+ * The changes of base->running are collected and sorted by api-path. The changes of
+ * base->candidate are then applied to a copy of running, unless they conflict. A
+ * candidate change conflicts with a running change on the same path with another
+ * result, with any running change below it, or with a running add or delete above it.
+ * Moves of ordered-by user entries only conflict on the same path.
+ */
+
+/*! Change of base->running
+ */
+struct merge_chg {
+    char        *mc_path;  /* api-path of node */
+    enum diff_op mc_op;
+    cxobj       *mc_x1;    /* Node in running, or NULL if deleted */
+};
+
+/*! Three-way merge state, callback argument of both diffs
+ */
+struct merge_ctx {
+    struct merge_chg *mg_chg;       /* Changes of base->running, sorted by path */
+    int               mg_n;
+    int               mg_len;
+    cxobj            *mg_xm;        /* Merged tree, initially copy of running */
+    cbuf             *mg_cb;        /* Conflict listing, or NULL */
+    int               mg_conflicts;
+    int               mg_applied;   /* Candidate changes applied to merged tree */
+    int               mg_same;      /* Candidate changes already in running */
+    struct timeval    mg_tcollect;  /* Time of base->running diff and sort */
+    struct timeval    mg_tapply;    /* Time of base->candidate diff and apply */
+};
+
+/*! Get api-path of a node, free with free()
+ */
+static char *
+merge_path(cxobj *x)
+{
+    cbuf *cb;
+    char *path = NULL;
+
+    if ((cb = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        return NULL;
+    }
+    if (xml2api_path_1(x, cb) < 0)
+        goto done;
+    if ((path = strdup(cbuf_get(cb))) == NULL)
+        clixon_err(OE_UNIX, errno, "strdup");
+ done:
+    cbuf_free(cb);
+    return path;
+}
+
+/*! Diff callback collecting a base->running change
+ */
+static int
+merge_collect_cb(struct diff_ctx *dc,
+                 enum diff_op     op,
+                 cxobj           *x0,
+                 cxobj           *x1)
+{
+    struct merge_ctx *mg = (struct merge_ctx *)dc->dc_arg;
+    struct merge_chg *mc;
+
+    if (mg->mg_n == mg->mg_len){
+        mg->mg_len = mg->mg_len ? 2*mg->mg_len : 64;
+        if ((mg->mg_chg = realloc(mg->mg_chg, mg->mg_len*sizeof(*mc))) == NULL){
+            clixon_err(OE_UNIX, errno, "realloc");
+            return -1;
+        }
+    }
+    mc = &mg->mg_chg[mg->mg_n];
+    if ((mc->mc_path = merge_path(x1?x1:x0)) == NULL)
+        return -1;
+    mc->mc_op = op;
+    mc->mc_x1 = x1;
+    mg->mg_n++;
+    return 0;
+}
+
+static int
+merge_chg_cmp(const void *a,
+              const void *b)
+{
+    return strcmp(((struct merge_chg *)a)->mc_path, ((struct merge_chg *)b)->mc_path);
+}
+
+/*! Index of first running change with path not less than key
+ */
+static int
+merge_lower(struct merge_ctx *mg,
+            const char       *key)
+{
+    int lo = 0;
+    int hi = mg->mg_n;
+    int mid;
+
+    while (lo < hi){
+        mid = (lo + hi)/2;
+        if (strcmp(mg->mg_chg[mid].mc_path, key) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/*! Check if a base->candidate change conflicts with a base->running change
+ *
+ * @param[in]  mg    Merge state
+ * @param[in]  path  api-path of changed node
+ * @param[in]  op    Candidate change
+ * @param[in]  x1    Candidate node, or NULL if deleted
+ * @param[out] same  Running has the same change on path
+ * @retval     1     Conflict, or same change
+ * @retval     0     No running change on, above or below path
+ * @retval    -1     Error
+ */
+static int
+merge_conflict(struct merge_ctx *mg,
+               const char       *path,
+               enum diff_op      op,
+               cxobj            *x1,
+               int              *same)
+{
+    int               retval = -1;
+    size_t            len = strlen(path);
+    struct merge_chg *mc;
+    char             *key = NULL;
+    char             *s;
+    int               i;
+
+    *same = 0;
+    if ((key = malloc(len + 2)) == NULL){
+        clixon_err(OE_UNIX, errno, "malloc");
+        goto done;
+    }
+    /* On path */
+    i = merge_lower(mg, path);
+    if (i < mg->mg_n && strcmp((mc = &mg->mg_chg[i])->mc_path, path) == 0){
+        if (mc->mc_op == op &&
+            (op == DIFF_DEL || xml_tree_equal(mc->mc_x1, x1) == 0))
+            *same = 1;
+        goto conflict;
+    }
+    /* Below path, all paths with prefix path/ are adjacent when sorted */
+    if (op != DIFF_MOVE){
+        snprintf(key, len + 2, "%s/", path);
+        i = merge_lower(mg, key);
+        if (i < mg->mg_n && strncmp(mg->mg_chg[i].mc_path, key, len + 1) == 0)
+            goto conflict;
+    }
+    /* Above path */
+    strcpy(key, path);
+    while ((s = strrchr(key, '/')) != NULL && s != key){
+        *s = '\0';
+        i = merge_lower(mg, key);
+        if (i < mg->mg_n && strcmp((mc = &mg->mg_chg[i])->mc_path, key) == 0 &&
+            mc->mc_op != DIFF_MOVE)
+            goto conflict;
+    }
+    retval = 0;
+ done:
+    if (key)
+        free(key);
+    return retval;
+ conflict:
+    retval = 1;
+    goto done;
+}
+
+/*! Find child of a merged tree node matching a base or candidate node
+ */
+static int
+merge_match(cxobj  *xp,
+            cxobj  *x,
+            cxobj **xm)
+{
+    yang_stmt *y;
+
+    *xm = NULL;
+    if ((y = xml_spec(x)) == NULL)
+        *xm = xml_find_type(xp, xml_prefix(x), xml_name(x), CX_ELMNT);
+    else if (match_base_child(xp, x, y, xm) < 0)
+        return -1;
+    return 0;
+}
+
+/*! Get parent in merged tree of the current candidate node
+ *
+ * @param[in]  dc      Diff context, path of candidate parents in dc_path
+ * @param[in]  xm      Merged tree
+ * @param[in]  create  Create missing parents
+ * @param[out] xp      Parent in merged tree, or NULL if missing
+ */
+static int
+merge_parent(struct diff_ctx *dc,
+             cxobj           *xm,
+             int              create,
+             cxobj          **xp)
+{
+    cxobj *xc;
+    int    i;
+
+    for (i=1; i<dc->dc_depth; i++){
+        if (merge_match(xm, dc->dc_path[i], &xc) < 0)
+            return -1;
+        if (xc == NULL){
+            if (!create){
+                xm = NULL;
+                break;
+            }
+            if ((xc = diff_out_node(dc->dc_path[i], xm)) == NULL ||
+                xml_sort(xm) < 0)
+                return -1;
+        }
+        xm = xc;
+    }
+    *xp = xm;
+    return 0;
+}
+
+/*! Insert a copy of a candidate node in the merged tree
+ *
+ * An ordered-by user entry is inserted after its preceding entry in candidate,
+ * other nodes are sorted in place.
+ * @param[in]  xp  Parent in merged tree
+ * @param[in]  x1  Node in candidate
+ */
+static int
+merge_insert(cxobj *xp,
+             cxobj *x1)
+{
+    yang_stmt *y = xml_spec(x1);
+    cxobj     *x1p = xml_parent(x1);
+    cxobj     *xprev = NULL;
+    cxobj     *xn;
+    cxobj     *xc;
+    int        pos = -1;
+    int        i;
+
+    if ((xn = xml_dup(x1)) == NULL)
+        return -1;
+    if (diff_user_ordered(y) && x1p != NULL){
+        for (i=0; i<xml_child_nr(x1p); i++){
+            if ((xc = xml_child_i(x1p, i)) == x1)
+                break;
+            if (xml_type(xc) == CX_ELMNT && xml_spec(xc) == y)
+                xprev = xc;
+        }
+        if (xprev && merge_match(xp, xprev, &xprev) < 0)
+            return -1;
+        for (i=0; i<xml_child_nr(xp); i++){
+            xc = xml_child_i(xp, i);
+            if (xprev ? xc == xprev : (xml_type(xc) == CX_ELMNT && xml_spec(xc) == y)){
+                pos = xprev ? i + 1 : i;
+                break;
+            }
+        }
+    }
+    if (pos < 0){
+        if (xml_addsub(xp, xn) < 0 || xml_sort(xp) < 0)
+            return -1;
+    }
+    else {
+        if (xml_child_insert_pos(xp, xn, pos) < 0)
+            return -1;
+        xml_parent_set(xn, xp);
+    }
+    return 0;
+}
+
+/*! Value of a node in conflict listing
+ */
+static char *
+merge_value(cxobj *x)
+{
+    yang_stmt *y;
+    char      *b;
+
+    if (x == NULL)
+        return "(none)";
+    if ((y = xml_spec(x)) != NULL ?
+        (yang_keyword_get(y) == Y_LEAF || yang_keyword_get(y) == Y_LEAF_LIST) :
+        xml_child_nr_type(x, CX_ELMNT) == 0)
+        return (b = xml_body(x)) != NULL ? b : "";
+    return "(subtree)";
+}
+
+/*! Diff callback applying a base->candidate change to the merged tree unless in conflict
+ */
+static int
+merge_apply_cb(struct diff_ctx *dc,
+               enum diff_op     op,
+               cxobj           *x0,
+               cxobj           *x1)
+{
+    int               retval = -1;
+    struct merge_ctx *mg = (struct merge_ctx *)dc->dc_arg;
+    char             *path = NULL;
+    cxobj            *xp;
+    cxobj            *xm = NULL;
+    int               same;
+    int               ret;
+
+    if ((path = merge_path(x1?x1:x0)) == NULL)
+        goto done;
+    if ((ret = merge_conflict(mg, path, op, x1, &same)) < 0)
+        goto done;
+    if (ret == 1 && same){
+        mg->mg_same++;
+        goto ok;
+    }
+    if (merge_parent(dc, mg->mg_xm, ret == 0, &xp) < 0)
+        goto done;
+    if (xp && merge_match(xp, x1?x1:x0, &xm) < 0)
+        goto done;
+    if (ret == 1){
+        mg->mg_conflicts++;
+        if (mg->mg_cb)
+            cprintf(mg->mg_cb, "%s base: %s candidate: %s running: %s\n",
+                    path, merge_value(x0), merge_value(x1), merge_value(xm));
+        goto ok;
+    }
+    if (xm && xml_purge(xm) < 0)
+        goto done;
+    if (op != DIFF_DEL && merge_insert(xp, x1) < 0)
+        goto done;
+    mg->mg_applied++;
+ ok:
+    retval = 0;
+ done:
+    if (path)
+        free(path);
+    return retval;
+}
+
+/*! Merge the changes of base->candidate into running
+ *
+ * @param[in]  x0  Base
+ * @param[in]  x1  Candidate
+ * @param[in]  x2  Running
+ * @param[in]  mg  Merge state, conflicts listed if mg_cb is set. Merged tree in mg_xm
+ */
+static int
+merge3(cxobj            *x0,
+       cxobj            *x1,
+       cxobj            *x2,
+       struct merge_ctx *mg)
+{
+    int             retval = -1;
+    struct diff_ctx dc = {0,};
+    struct timeval  t0;
+    struct timeval  t1;
+
+    gettimeofday(&t0, NULL);
+    dc.dc_fn = merge_collect_cb;
+    dc.dc_arg = mg;
+    if (xml_diff(&dc, x0, x2) < 0)
+        goto done;
+    if (mg->mg_n)
+        qsort(mg->mg_chg, mg->mg_n, sizeof(*mg->mg_chg), merge_chg_cmp);
+    gettimeofday(&t1, NULL);
+    timersub(&t1, &t0, &mg->mg_tcollect);
+    if ((mg->mg_xm = xml_dup(x2)) == NULL)
+        goto done;
+    gettimeofday(&t0, NULL);
+    dc.dc_fn = merge_apply_cb;
+    if (xml_diff(&dc, x0, x1) < 0)
+        goto done;
+    gettimeofday(&t1, NULL);
+    timersub(&t1, &t0, &mg->mg_tapply);
+    retval = 0;
+ done:
+    if (dc.dc_path)
+        free(dc.dc_path);
+    if (dc.dc_out)
+        free(dc.dc_out);
+    return retval;
+}
+
+/*! Free merge state
+ */
+static void
+merge_free(struct merge_ctx *mg)
+{
+    int i;
+
+    for (i=0; i<mg->mg_n; i++)
+        free(mg->mg_chg[i].mc_path);
+    if (mg->mg_chg)
+        free(mg->mg_chg);
+    if (mg->mg_xm)
+        xml_free(mg->mg_xm);
+    if (mg->mg_cb)
+        cbuf_free(mg->mg_cb);
+    memset(mg, 0, sizeof(*mg));
+}
+
+/*
+ * Bulk diff (-b)
+ * One baseline against many candidates, such as a golden config against the running
+ * config of each device. The baseline is parsed once, and hashed once with -m, before
+ * the workers are forked, and then shared copy-on-write. Worker processes are used
+ * since the clixon parsers are not reentrant. Worker w parses and diffs candidates
+ * w, w+nr, w+2*nr,.. into its own file, and a JSON line per candidate is then printed
+ * in candidate order.
+ */
+
+/*! Bulk diff state of a candidate, callback argument
+ */
+struct bulk_ctx {
+    cbuf *bc_cb;    /* JSON list of changes */
+    int   bc_n;     /* Number of changes */
+};
+
+/*! Print a JSON string
+ */
+static void
+bulk_json_str(cbuf       *cb,
+              const char *str)
+{
+    const char *s;
+
+    cprintf(cb, "\"");
+    for (s=str; *s; s++){
+        if (*s == '"' || *s == '\\')
+            cprintf(cb, "\\%c", *s);
+        else if ((unsigned char)*s < 0x20)
+            cprintf(cb, "\\u%04x", (unsigned char)*s);
+        else
+            cprintf(cb, "%c", *s);
+    }
+    cprintf(cb, "\"");
+}
+
+/*! Diff callback adding a change of a candidate to the JSON list
+ */
+static int
+bulk_cb(struct diff_ctx *dc,
+        enum diff_op     op,
+        cxobj           *x0,
+        cxobj           *x1)
+{
+    struct bulk_ctx *bc = (struct bulk_ctx *)dc->dc_arg;
+    char            *path;
+
+    if ((path = merge_path(x1?x1:x0)) == NULL)
+        return -1;
+    cprintf(bc->bc_cb, "%s{\"op\":\"%s\",\"path\":", bc->bc_n?",":"",
+            op==DIFF_ADD?"add":op==DIFF_DEL?"delete":op==DIFF_CHANGE?"change":"move");
+    bulk_json_str(bc->bc_cb, path);
+    cprintf(bc->bc_cb, "}");
+    bc->bc_n++;
+    free(path);
+    return 0;
+}
+
+/*! Diff candidates of one worker, write a JSON line per candidate
+ *
+ * A candidate that cannot be parsed or validated gets a line with the error.
+ * @param[in]  h        Clixon handle
+ * @param[in]  f        Output file of worker
+ * @param[in]  cands    Candidate files
+ * @param[in]  ncands   Number of candidates
+ * @param[in]  worker   Worker number
+ * @param[in]  workers  Number of workers
+ * @param[in]  x0       Baseline
+ * @param[in]  yspec    Yang spec
+ * @param[in]  format   Format of candidates
+ * @param[in]  detect   Detect format of each candidate
+ * @param[in]  hm       Merkle hashes of baseline, or NULL
+ */
+static int
+bulk_worker(clixon_handle     h,
+            FILE             *f,
+            char            **cands,
+            int               ncands,
+            int               worker,
+            int               workers,
+            cxobj            *x0,
+            yang_stmt        *yspec,
+            enum format_enum  format,
+            int               detect,
+            struct diff_hmap *hm)
+{
+    int              retval = -1;
+    struct diff_ctx  dc = {0,};
+    struct bulk_ctx  bc = {0,};
+    struct diff_hmap hm1 = {0,};
+    cbuf            *cbname = NULL;
+    cbuf            *cberr = NULL;
+    cxobj           *x1 = NULL;
+    uint64_t         hash;
+    int              i;
+
+    if ((bc.bc_cb = cbuf_new()) == NULL ||
+        (cbname = cbuf_new()) == NULL ||
+        (cberr = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    dc.dc_fn = bulk_cb;
+    dc.dc_arg = &bc;
+    if (hm){
+        dc.dc_hash = hm;
+        dc.dc_hash1 = &hm1;
+    }
+    for (i=worker; i<ncands; i+=workers){
+        cbuf_reset(cbname);
+        bulk_json_str(cbname, cands[i]);
+        if (diff_parse_file(h, cands[i], format, detect, yspec, &x1) < 0){
+            cbuf_reset(cberr);
+            bulk_json_str(cberr, clixon_err_reason() ? clixon_err_reason() : "");
+            fprintf(f, "{\"error\":%s,\"device\":%s}\n", cbuf_get(cberr), cbuf_get(cbname));
+            if (x1){
+                xml_free(x1);
+                x1 = NULL;
+            }
+            continue;
+        }
+        if (hm){
+            hmap_clear(&hm1);
+            if (diff_hash(&hm1, x1, &hash) < 0)
+                goto done;
+        }
+        cbuf_reset(bc.bc_cb);
+        bc.bc_n = 0;
+        if (xml_diff(&dc, x0, x1) < 0)
+            goto done;
+        fprintf(f, "{\"changes\":%d,\"device\":%s,\"paths\":[%s]}\n",
+                bc.bc_n, cbuf_get(cbname), cbuf_get(bc.bc_cb));
+        xml_free(x1);
+        x1 = NULL;
+    }
+    if (fflush(f) != 0){
+        clixon_err(OE_UNIX, errno, "fflush");
+        goto done;
+    }
+    retval = 0;
+ done:
+    if (x1)
+        xml_free(x1);
+    hmap_free(&hm1);
+    if (dc.dc_path)
+        free(dc.dc_path);
+    if (dc.dc_out)
+        free(dc.dc_out);
+    if (bc.bc_cb)
+        cbuf_free(bc.bc_cb);
+    if (cbname)
+        cbuf_free(cbname);
+    if (cberr)
+        cbuf_free(cberr);
+    return retval;
+}
+
+static int
+bulk_cmp(const void *a,
+         const void *b)
+{
+    return strcmp(*(char **)a, *(char **)b);
+}
+
+/*! Get candidate files from a directory, or from a file with one filename per line
+ *
+ * Directory entries are sorted by name, hidden files are skipped. In a file, empty
+ * lines and lines starting with # are skipped.
+ * @param[in]  source  Directory or file
+ * @param[out] candsp  Malloced vector of malloced filenames
+ * @param[out] np      Number of candidates
+ */
+static int
+bulk_candidates(char   *source,
+                char ***candsp,
+                int    *np)
+{
+    int            retval = -1;
+    struct stat    st;
+    DIR           *dir = NULL;
+    struct dirent *de;
+    FILE          *f = NULL;
+    char          *line = NULL;
+    size_t         linelen = 0;
+    ssize_t        len;
+    char         **cands = NULL;
+    char          *name;
+    int            n = 0;
+
+    if (stat(source, &st) < 0){
+        clixon_err(OE_UNIX, errno, "stat(%s)", source);
+        goto done;
+    }
+    if (S_ISDIR(st.st_mode)){
+        if ((dir = opendir(source)) == NULL){
+            clixon_err(OE_UNIX, errno, "opendir(%s)", source);
+            goto done;
+        }
+    }
+    else if ((f = fopen(source, "r")) == NULL){
+        clixon_err(OE_UNIX, errno, "fopen(%s)", source);
+        goto done;
+    }
+    while (1){
+        name = NULL;
+        if (dir){
+            if ((de = readdir(dir)) == NULL)
+                break;
+            if (de->d_name[0] == '.')
+                continue;
+            if ((name = malloc(strlen(source) + strlen(de->d_name) + 2)) == NULL){
+                clixon_err(OE_UNIX, errno, "malloc");
+                goto done;
+            }
+            sprintf(name, "%s/%s", source, de->d_name);
+            if (stat(name, &st) < 0 || !S_ISREG(st.st_mode)){
+                free(name);
+                continue;
+            }
+        }
+        else {
+            if ((len = getline(&line, &linelen, f)) < 0)
+                break;
+            if (len && line[len-1] == '\n')
+                line[--len] = '\0';
+            if (len == 0 || line[0] == '#')
+                continue;
+            if ((name = strdup(line)) == NULL){
+                clixon_err(OE_UNIX, errno, "strdup");
+                goto done;
+            }
+        }
+        if ((cands = realloc(cands, (n+1)*sizeof(char*))) == NULL){
+            clixon_err(OE_UNIX, errno, "realloc");
+            free(name);
+            goto done;
+        }
+        cands[n++] = name;
+    }
+    if (dir && n)
+        qsort(cands, n, sizeof(char*), bulk_cmp);
+    *candsp = cands;
+    *np = n;
+    cands = NULL;
+    retval = 0;
+ done:
+    if (cands){
+        while (n--)
+            free(cands[n]);
+        free(cands);
+    }
+    if (line)
+        free(line);
+    if (dir)
+        closedir(dir);
+    if (f)
+        fclose(f);
+    return retval;
+}
+
+/*! Diff a baseline against many candidates with worker processes
+ *
+ * Prints a JSON line per candidate on stdout, and the throughput on stderr
+ * @param[in]  h        Clixon handle
+ * @param[in]  source   Directory of candidates, or file with candidate filenames
+ * @param[in]  x0       Baseline
+ * @param[in]  yspec    Yang spec
+ * @param[in]  format   Format of candidates
+ * @param[in]  detect   Detect format of each candidate
+ * @param[in]  hm       Merkle hashes of baseline, or NULL
+ * @param[in]  workers  Number of worker processes
+ */
+static int
+bulk_diff(clixon_handle     h,
+          char             *source,
+          cxobj            *x0,
+          yang_stmt        *yspec,
+          enum format_enum  format,
+          int               detect,
+          struct diff_hmap *hm,
+          int               workers)
+{
+    int            retval = -1;
+    char         **cands = NULL;
+    int            ncands = 0;
+    FILE         **files = NULL;
+    pid_t         *pids = NULL;
+    char          *line = NULL;
+    size_t         linelen = 0;
+    struct timeval t0;
+    struct timeval t1;
+    struct timeval td;
+    double         secs;
+    int            changes;
+    int            changed = 0;
+    int            errors = 0;
+    int            failed = 0;
+    int            status;
+    int            w;
+    int            i;
+
+    if (bulk_candidates(source, &cands, &ncands) < 0)
+        goto done;
+    if (workers > ncands)
+        workers = ncands ? ncands : 1;
+    if ((files = calloc(workers, sizeof(FILE*))) == NULL ||
+        (pids = calloc(workers, sizeof(pid_t))) == NULL){
+        clixon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    for (w=0; w<workers; w++)
+        if ((files[w] = tmpfile()) == NULL){
+            clixon_err(OE_UNIX, errno, "tmpfile");
+            goto done;
+        }
+    fflush(stdout);
+    fflush(stderr);
+    gettimeofday(&t0, NULL);
+    for (w=0; w<workers; w++){
+        if ((pids[w] = fork()) < 0){
+            clixon_err(OE_UNIX, errno, "fork");
+            goto done;
+        }
+        if (pids[w] == 0)
+            _exit(bulk_worker(h, files[w], cands, ncands, w, workers,
+                              x0, yspec, format, detect, hm) < 0 ? 1 : 0);
+    }
+    for (w=0; w<workers; w++){
+        if (waitpid(pids[w], &status, 0) < 0 ||
+            !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            failed++;
+        pids[w] = 0;
+    }
+    gettimeofday(&t1, NULL);
+    timersub(&t1, &t0, &td);
+    if (failed){
+        clixon_err(OE_UNIX, 0, "%d of %d workers failed", failed, workers);
+        goto done;
+    }
+    for (w=0; w<workers; w++)
+        rewind(files[w]);
+    for (i=0; i<ncands; i++){
+        if (getline(&line, &linelen, files[i%workers]) < 0){
+            clixon_err(OE_UNIX, errno, "Missing result of %s", cands[i]);
+            goto done;
+        }
+        if (sscanf(line, "{\"changes\":%d", &changes) != 1)
+            errors++;
+        else if (changes)
+            changed++;
+        fputs(line, stdout);
+    }
+    secs = td.tv_sec + td.tv_usec/1000000.0;
+    fprintf(stderr, "bulk: candidates: %d changed: %d errors: %d workers: %d time: %lu.%06lu throughput: %.1f/s\n",
+            ncands, changed, errors, workers, td.tv_sec, td.tv_usec,
+            secs > 0 ? ncands/secs : 0.0);
+    retval = 0;
+ done:
+    if (pids){
+        for (w=0; w<workers; w++)
+            if (pids[w] > 0){
+                kill(pids[w], SIGTERM);
+                waitpid(pids[w], NULL, 0);
+            }
+        free(pids);
+    }
+    if (files){
+        for (w=0; w<workers; w++)
+            if (files[w])
+                fclose(files[w]);
+        free(files);
+    }
+    if (line)
+        free(line);
+    if (cands){
+        for (i=0; i<ncands; i++)
+            free(cands[i]);
+        free(cands);
+    }
+    return retval;
+}
+
+/*
+ * Streaming diff (-S)
+ * Two XML files are read with a pull tokenizer and compared in lockstep, without
+ * building the trees. Siblings must be in YANG order, as written by clixon, and list
+ * keys must come first in each entry (RFC 7950 7.8.5). Only the path of the current
+ * element with its keys is kept for each file, and the previous sibling on each level
+ * to verify the order. Differences are printed as JSON lines when found.
+ * Repeated unknown elements and entries of lists without keys are matched by position.
+ * Attributes other than namespace declarations are only compared in anydata.
+ */
+
+enum sd_tok {
+    SD_EOF,
+    SD_START,   /* Start tag, name in ss_name and attributes in ss_attrs */
+    SD_END,     /* End tag, name in ss_name */
+    SD_TEXT     /* Character data, decoded, in ss_text */
+};
+
+/*! Streaming XML reader of a file
+ */
+struct sd_stream {
+    FILE       *ss_f;
+    char       *ss_file;
+    int         ss_line;
+    enum sd_tok ss_tok;     /* Last token */
+    int         ss_unget;   /* Return last token again */
+    int         ss_empty;   /* Last start tag was <name/>, end tag is next */
+    int         ss_pending; /* Character after < of tag not yet read, or 0 */
+    cbuf       *ss_name;
+    cvec       *ss_attrs;   /* Attributes of last start tag, name with prefix */
+    cbuf       *ss_text;
+    cxobj      *ss_top;     /* Parent of top-level elements, root of current path */
+    int         ss_nodes;   /* Elements read */
+};
+
+/*! Streaming diff state
+ */
+struct sd_ctx {
+    yang_stmt *sc_yspec;
+    cbuf      *sc_cb;
+    int        sc_adds;
+    int        sc_dels;
+    int        sc_changes;
+};
+
+static int
+sd_getc(struct sd_stream *ss)
+{
+    int c;
+
+    if ((c = getc(ss->ss_f)) == '\n')
+        ss->ss_line++;
+    return c;
+}
+
+/*! Read until and including end string, such as "-->"
+ *
+ * @param[in]  ss   Stream
+ * @param[in]  end  End string, at most 3 characters
+ * @param[in]  cb   Append characters before end string, or NULL
+ */
+static int
+sd_until(struct sd_stream *ss,
+         const char       *end,
+         cbuf             *cb)
+{
+    size_t len = strlen(end);
+    char   last[4] = {0,};
+    int    c;
+
+    while ((c = sd_getc(ss)) != EOF){
+        memmove(last, last+1, len-1);
+        last[len-1] = c;
+        if (cb)
+            cprintf(cb, "%c", c);
+        if (memcmp(last, end, len) == 0){
+            if (cb)
+                cbuf_trunc(cb, cbuf_len(cb) - len);
+            return 0;
+        }
+    }
+    clixon_err(OE_XML, 0, "%s:%d: Missing %s", ss->ss_file, ss->ss_line, end);
+    return -1;
+}
+
+/*! Decode an entity reference after &, and append it
+ */
+static int
+sd_entity(struct sd_stream *ss,
+          cbuf             *cb)
+{
+    char          ref[12];
+    int           i = 0;
+    int           c;
+    unsigned long u;
+
+    while ((c = sd_getc(ss)) != EOF && c != ';' && i < sizeof(ref)-1)
+        ref[i++] = c;
+    ref[i] = '\0';
+    if (c != ';'){
+        clixon_err(OE_XML, 0, "%s:%d: Bad entity &%s", ss->ss_file, ss->ss_line, ref);
+        return -1;
+    }
+    if (strcmp(ref, "lt") == 0)
+        cprintf(cb, "<");
+    else if (strcmp(ref, "gt") == 0)
+        cprintf(cb, ">");
+    else if (strcmp(ref, "amp") == 0)
+        cprintf(cb, "&");
+    else if (strcmp(ref, "quot") == 0)
+        cprintf(cb, "\"");
+    else if (strcmp(ref, "apos") == 0)
+        cprintf(cb, "'");
+    else if (ref[0] == '#'){
+        u = ref[1] == 'x' ? strtoul(ref+2, NULL, 16) : strtoul(ref+1, NULL, 10);
+        if (u < 0x80)
+            cprintf(cb, "%c", (int)u);
+        else if (u < 0x800)
+            cprintf(cb, "%c%c", (int)(0xc0|(u>>6)), (int)(0x80|(u&0x3f)));
+        else if (u < 0x10000)
+            cprintf(cb, "%c%c%c", (int)(0xe0|(u>>12)), (int)(0x80|((u>>6)&0x3f)),
+                    (int)(0x80|(u&0x3f)));
+        else
+            cprintf(cb, "%c%c%c%c", (int)(0xf0|(u>>18)), (int)(0x80|((u>>12)&0x3f)),
+                    (int)(0x80|((u>>6)&0x3f)), (int)(0x80|(u&0x3f)));
+    }
+    else {
+        clixon_err(OE_XML, 0, "%s:%d: Unknown entity &%s;", ss->ss_file, ss->ss_line, ref);
+        return -1;
+    }
+    return 0;
+}
+
+/*! Read a name or attribute value, first character in c, stop at delimiter
+ *
+ * @param[in]  ss     Stream
+ * @param[in]  c      First character
+ * @param[in]  quote  Quote of attribute value, or 0 for a name
+ * @param[in]  cb     Name or decoded value
+ * @retval     c      First character after name, or after the ending quote
+ */
+static int
+sd_word(struct sd_stream *ss,
+        int               c,
+        int               quote,
+        cbuf             *cb)
+{
+    cbuf_reset(cb);
+    while (c != EOF){
+        if (quote){
+            if (c == quote)
+                return sd_getc(ss);
+            if (c == '&'){
+                if (sd_entity(ss, cb) < 0)
+                    return -2;
+            }
+            else
+                cprintf(cb, "%c", c);
+        }
+        else if (strchr(" \t\r\n/>=", c) != NULL)
+            return c;
+        else
+            cprintf(cb, "%c", c);
+        c = sd_getc(ss);
+    }
+    return c;
+}
+
+/*! Read a start tag after <, with attributes
+ */
+static int
+sd_start(struct sd_stream *ss,
+         int               c)
+{
+    cbuf *cba = NULL;
+    cbuf *cbv = NULL;
+    int   retval = -1;
+    int   quote;
+
+    if (cvec_reset(ss->ss_attrs) < 0){
+        clixon_err(OE_UNIX, errno, "cvec_reset");
+        goto done;
+    }
+    if ((cba = cbuf_new()) == NULL || (cbv = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    if ((c = sd_word(ss, c, 0, ss->ss_name)) < -1)
+        goto done;
+    while (1){
+        while (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+            c = sd_getc(ss);
+        if (c == '>')
+            break;
+        if (c == '/'){
+            if ((c = sd_getc(ss)) != '>')
+                goto bad;
+            ss->ss_empty = 1;
+            break;
+        }
+        if (c == EOF || (c = sd_word(ss, c, 0, cba)) == EOF || cbuf_len(cba) == 0)
+            goto bad;
+        while (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+            c = sd_getc(ss);
+        if (c != '=')
+            goto bad;
+        do {
+            quote = sd_getc(ss);
+        } while (quote == ' ' || quote == '\t' || quote == '\r' || quote == '\n');
+        if (quote != '"' && quote != '\'')
+            goto bad;
+        if ((c = sd_word(ss, sd_getc(ss), quote, cbv)) < -1)
+            goto done;
+        if (cvec_add_string(ss->ss_attrs, cbuf_get(cba), cbuf_get(cbv)) < 0){
+            clixon_err(OE_UNIX, errno, "cvec_add_string");
+            goto done;
+        }
+    }
+    ss->ss_nodes++;
+    retval = 0;
+ done:
+    if (cba)
+        cbuf_free(cba);
+    if (cbv)
+        cbuf_free(cbv);
+    return retval;
+ bad:
+    clixon_err(OE_XML, 0, "%s:%d: Bad start tag <%s", ss->ss_file, ss->ss_line,
+               cbuf_get(ss->ss_name));
+    goto done;
+}
+
+/*! Read next token
+ *
+ * Declarations, comments and DOCTYPE are skipped, CDATA is character data.
+ * @param[in]  ss   Stream
+ * @param[out] tok  Token
+ */
+static int
+sd_token(struct sd_stream *ss,
+         enum sd_tok      *tok)
+{
+    int c;
+
+    if (ss->ss_unget){
+        ss->ss_unget = 0;
+        *tok = ss->ss_tok;
+        return 0;
+    }
+    if (ss->ss_empty){
+        ss->ss_empty = 0;
+        *tok = ss->ss_tok = SD_END;
+        return 0;
+    }
+    cbuf_reset(ss->ss_text);
+    while (1){
+        if (ss->ss_pending){
+            c = ss->ss_pending;
+            ss->ss_pending = 0;
+        }
+        else {
+            if ((c = sd_getc(ss)) == EOF){
+                *tok = ss->ss_tok = cbuf_len(ss->ss_text) ? SD_TEXT : SD_EOF;
+                return 0;
+            }
+            if (c == '&'){
+                if (sd_entity(ss, ss->ss_text) < 0)
+                    return -1;
+                continue;
+            }
+            if (c != '<'){
+                cprintf(ss->ss_text, "%c", c);
+                continue;
+            }
+            c = sd_getc(ss);
+            if (c == '?'){
+                if (sd_until(ss, "?>", NULL) < 0)
+                    return -1;
+                continue;
+            }
+            if (c == '!'){
+                if ((c = sd_getc(ss)) == '-'){
+                    if (sd_until(ss, "-->", NULL) < 0)
+                        return -1;
+                }
+                else if (c == '['){
+                    if (sd_until(ss, "CDATA[", NULL) < 0 ||
+                        sd_until(ss, "]]>", ss->ss_text) < 0)
+                        return -1;
+                }
+                else if (sd_until(ss, ">", NULL) < 0)
+                    return -1;
+                continue;
+            }
+            /* Text before tag is returned first, tag is read next time */
+            if (cbuf_len(ss->ss_text)){
+                ss->ss_pending = c;
+                *tok = ss->ss_tok = SD_TEXT;
+                return 0;
+            }
+        }
+        if (c == '/'){
+            if ((c = sd_word(ss, sd_getc(ss), 0, ss->ss_name)) < -1)
+                return -1;
+            while (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+                c = sd_getc(ss);
+            if (c != '>'){
+                clixon_err(OE_XML, 0, "%s:%d: Bad end tag </%s", ss->ss_file, ss->ss_line,
+                           cbuf_get(ss->ss_name));
+                return -1;
+            }
+            *tok = ss->ss_tok = SD_END;
+            return 0;
+        }
+        if (sd_start(ss, c) < 0)
+            return -1;
+        *tok = ss->ss_tok = SD_START;
+        return 0;
+    }
+}
+
+/*! Check if character data is whitespace only
+ */
+static int
+sd_blank(const char *str)
+{
+    for (; *str; str++)
+        if (strchr(" \t\r\n", *str) == NULL)
+            return 0;
+    return 1;
+}
+
+/*! Read character data of a leaf up to its end tag, and add as body
+ */
+static int
+sd_body(struct sd_stream *ss,
+        cxobj            *x)
+{
+    enum sd_tok tok;
+    cxobj      *xb;
+
+    if ((xb = xml_new("body", x, CX_BODY)) == NULL)
+        return -1;
+    if (sd_token(ss, &tok) < 0)
+        return -1;
+    if (tok == SD_TEXT){
+        if (xml_value_set(xb, cbuf_get(ss->ss_text)) < 0)
+            return -1;
+        if (sd_token(ss, &tok) < 0)
+            return -1;
+    }
+    else if (xml_value_set(xb, "") < 0)
+        return -1;
+    if (tok != SD_END){
+        clixon_err(OE_XML, 0, "%s:%d: %s: leaf expected", ss->ss_file, ss->ss_line, xml_name(x));
+        return -1;
+    }
+    return 0;
+}
+
+/*! Hash attributes of last start tag, in any order
+ */
+static uint64_t
+sd_attrs_hash(struct sd_stream *ss,
+              uint64_t          h)
+{
+    cg_var  *cv;
+    uint64_t ha = 0;
+    uint64_t hv;
+    char    *str;
+
+    cv = NULL;
+    while ((cv = cvec_each(ss->ss_attrs, cv)) != NULL){
+        str = cv_name_get(cv);
+        hv = fnv1a(FNV1A_OFFSET, str, strlen(str)+1);
+        str = cv_string_get(cv);
+        hv = fnv1a(hv, str, strlen(str)+1);
+        ha += hv; /* Attribute order is not significant */
+    }
+    return fnv1a(h, &ha, sizeof(ha));
+}
+
+/*! Read content of anydata up to its end tag, and add its hash as body
+ *
+ * Attributes of the anydata element and of its content are included
+ */
+static int
+sd_anydata(struct sd_stream *ss,
+           cxobj            *x)
+{
+    enum sd_tok tok;
+    uint64_t    h = FNV1A_OFFSET;
+    int         depth = 0;
+    cxobj      *xb;
+    char        hex[20];
+
+    h = sd_attrs_hash(ss, h);
+    while (1){
+        if (sd_token(ss, &tok) < 0)
+            return -1;
+        if (tok == SD_EOF){
+            clixon_err(OE_XML, 0, "%s:%d: Unexpected EOF", ss->ss_file, ss->ss_line);
+            return -1;
+        }
+        if (tok == SD_END && depth-- == 0)
+            break;
+        if (tok == SD_START)
+            depth++;
+        h = fnv1a(h, &tok, sizeof(tok));
+        if (tok == SD_TEXT)
+            h = fnv1a(h, cbuf_get(ss->ss_text), cbuf_len(ss->ss_text));
+        else
+            h = fnv1a(h, cbuf_get(ss->ss_name), cbuf_len(ss->ss_name));
+        if (tok == SD_START)
+            h = sd_attrs_hash(ss, h);
+    }
+    snprintf(hex, sizeof(hex), "%016" PRIx64, h);
+    if ((xb = xml_new("body", x, CX_BODY)) == NULL ||
+        xml_value_set(xb, hex) < 0)
+        return -1;
+    return 0;
+}
+
+/*! Check if a record is a leaf, ie has a body
+ */
+static int
+sd_leaf(cxobj *x)
+{
+    return xml_body_get(x) != NULL;
+}
+
+/*! Add element of last start tag to a parent, with prefix and namespace declarations
+ */
+static cxobj *
+sd_element(struct sd_stream *ss,
+           cxobj            *xp)
+{
+    cxobj  *x;
+    cg_var *cv;
+    char   *name;
+    char   *p;
+    char   *attr;
+    int     ret;
+
+    name = cbuf_get(ss->ss_name);
+    p = strchr(name, ':');
+    if ((x = xml_new(p ? p+1 : name, xp, CX_ELMNT)) == NULL)
+        return NULL;
+    if (p){
+        *p = '\0';
+        ret = xml_prefix_set(x, name);
+        *p = ':';
+        if (ret < 0)
+            return NULL;
+    }
+    cv = NULL;
+    while ((cv = cvec_each(ss->ss_attrs, cv)) != NULL){
+        attr = cv_name_get(cv);
+        if (strcmp(attr, "xmlns") == 0){
+            if (xml_add_attr(x, "xmlns", cv_string_get(cv), NULL, NULL) == NULL)
+                return NULL;
+        }
+        else if (strncmp(attr, "xmlns:", 6) == 0){
+            if (xml_add_attr(x, attr+6, cv_string_get(cv), "xmlns", NULL) == NULL)
+                return NULL;
+        }
+    }
+    return x;
+}
+
+/*! Read next child element of a parent as a record: element with spec and keys or body
+ *
+ * A leaf is read up to its end tag, other elements up to their keys
+ * @param[in]  ss     Stream
+ * @param[in]  xp     Parent record
+ * @param[in]  yspec  Yang spec
+ * @param[out] xr     Record, added to xp, or NULL if end of parent
+ */
+static int
+sd_next(struct sd_stream *ss,
+        cxobj            *xp,
+        yang_stmt        *yspec,
+        cxobj           **xr)
+{
+    enum sd_tok tok;
+    yang_stmt  *yp;
+    yang_stmt  *y = NULL;
+    yang_stmt  *ymod;
+    cxobj      *x;
+    cxobj      *xk;
+    cg_var     *cvi;
+    char       *name;
+    char       *ns;
+
+    *xr = NULL;
+    do {
+        if (sd_token(ss, &tok) < 0)
+            return -1;
+    } while (tok == SD_TEXT && sd_blank(cbuf_get(ss->ss_text)));
+    switch (tok){
+    case SD_EOF:
+        if (xp != ss->ss_top){
+            clixon_err(OE_XML, 0, "%s:%d: Unexpected EOF in %s",
+                       ss->ss_file, ss->ss_line, xml_name(xp));
+            return -1;
+        }
+        return 0;
+    case SD_END:
+        name = cbuf_get(ss->ss_name);
+        name = strchr(name, ':') ? strchr(name, ':') + 1 : name;
+        if (xp == ss->ss_top || strcmp(name, xml_name(xp)) != 0){
+            clixon_err(OE_XML, 0, "%s:%d: Unexpected </%s>",
+                       ss->ss_file, ss->ss_line, cbuf_get(ss->ss_name));
+            return -1;
+        }
+        return 0;
+    case SD_TEXT:
+        clixon_err(OE_XML, 0, "%s:%d: Mixed content in %s not supported",
+                   ss->ss_file, ss->ss_line, xml_name(xp));
+        return -1;
+    case SD_START:
+        break;
+    }
+    if ((x = sd_element(ss, xp)) == NULL)
+        return -1;
+    name = xml_name(x);
+    if (xp == ss->ss_top){
+        ns = NULL;
+        if (xml2ns(x, xml_prefix(x), &ns) < 0)
+            return -1;
+        if (ns && (ymod = yang_find_module_by_namespace(yspec, ns)) != NULL)
+            y = yang_find_datanode(ymod, name);
+    }
+    else if ((yp = xml_spec(xp)) != NULL)
+        y = yang_find_datanode(yp, name);
+    xml_spec_set(x, y);
+    *xr = x;
+    if (y == NULL){
+        /* Unknown: leaf unless a start tag follows */
+        if (sd_token(ss, &tok) < 0)
+            return -1;
+        if (tok == SD_TEXT && sd_blank(cbuf_get(ss->ss_text)) &&
+            sd_token(ss, &tok) < 0)
+            return -1;
+        ss->ss_unget = 1;
+        if (tok == SD_START)
+            return 0;
+        return sd_body(ss, x);
+    }
+    switch (yang_keyword_get(y)){
+    case Y_LEAF:
+    case Y_LEAF_LIST:
+        return sd_body(ss, x);
+    case Y_ANYDATA:
+    case Y_ANYXML:
+        return sd_anydata(ss, x);
+    case Y_LIST:
+        cvi = NULL;
+        while ((cvi = cvec_each(yang_cvec_get(y), cvi)) != NULL){
+            do {
+                if (sd_token(ss, &tok) < 0)
+                    return -1;
+            } while (tok == SD_TEXT && sd_blank(cbuf_get(ss->ss_text)));
+            name = cbuf_get(ss->ss_name);
+            name = strchr(name, ':') ? strchr(name, ':') + 1 : name;
+            if (tok != SD_START || strcmp(name, cv_string_get(cvi)) != 0){
+                clixon_err(OE_XML, 0, "%s:%d: %s: key %s not first",
+                           ss->ss_file, ss->ss_line, xml_name(x), cv_string_get(cvi));
+                return -1;
+            }
+            if ((xk = xml_new(name, x, CX_ELMNT)) == NULL)
+                return -1;
+            xml_spec_set(xk, yang_find(y, Y_LEAF, name));
+            if (sd_body(ss, xk) < 0)
+                return -1;
+        }
+        break;
+    default:
+        break;
+    }
+    return 0;
+}
+
+/*! Check if siblings of a spec are matched by position: unknown or list without keys
+ */
+static int
+sd_positional(yang_stmt *y)
+{
+    cvec *cvk;
+
+    if (y == NULL)
+        return 1;
+    return yang_keyword_get(y) == Y_LIST &&
+        ((cvk = yang_cvec_get(y)) == NULL || cvec_len(cvk) == 0);
+}
+
+/*! Compare two records of sibling elements in YANG order, unknown elements last
+ *
+ * Records of the same unknown element or list without keys are equal
+ */
+static int
+sd_cmp(cxobj *x0,
+       cxobj *x1)
+{
+    yang_stmt *y0 = xml_spec(x0);
+    yang_stmt *y1 = xml_spec(x1);
+
+    if (y0 == NULL || y1 == NULL){
+        if (y0 != y1)
+            return y0 == NULL ? 1 : -1;
+        return strcmp(xml_name(x0), xml_name(x1));
+    }
+    if (y0 == y1 && sd_positional(y0))
+        return 0;
+    return xml_cmp(x0, x1, 0, 0, NULL);
+}
+
+/*! Skip rest of an element after its record, to and including its end tag
+ */
+static int
+sd_skip(struct sd_stream *ss,
+        cxobj            *x)
+{
+    enum sd_tok tok;
+    int         depth = 0;
+
+    if (sd_leaf(x))
+        return 0;
+    while (1){
+        if (sd_token(ss, &tok) < 0)
+            return -1;
+        switch (tok){
+        case SD_EOF:
+            clixon_err(OE_XML, 0, "%s:%d: Unexpected EOF in %s",
+                       ss->ss_file, ss->ss_line, xml_name(x));
+            return -1;
+        case SD_START:
+            depth++;
+            break;
+        case SD_END:
+            if (depth-- == 0)
+                return 0;
+            break;
+        case SD_TEXT:
+            break;
+        }
+    }
+}
+
+/*! Read next sibling record and verify it is after the previous in YANG order
+ *
+ * The previous record is freed, the current becomes previous
+ * @param[in]     ss     Stream
+ * @param[in]     xp     Parent record
+ * @param[in]     yspec  Yang spec
+ * @param[in,out] x      Current record, next record or NULL at end of parent
+ * @param[in,out] xprev  Previous record
+ */
+static int
+sd_advance(struct sd_stream *ss,
+           cxobj            *xp,
+           yang_stmt        *yspec,
+           cxobj           **x,
+           cxobj           **xprev)
+{
+    cbuf *cb = NULL;
+    int   c;
+
+    if (*xprev)
+        xml_purge(*xprev);
+    *xprev = *x;
+    if (sd_next(ss, xp, yspec, x) < 0)
+        return -1;
+    if (*x == NULL || *xprev == NULL)
+        return 0;
+    if (xml_spec(*x) && xml_spec(*x) == xml_spec(*xprev) && diff_user_ordered(xml_spec(*x)))
+        return 0;
+    if ((c = sd_cmp(*xprev, *x)) < 0)
+        return 0;
+    /* Repeated unknown elements and entries of lists without keys */
+    if (c == 0 && sd_positional(xml_spec(*x)))
+        return 0;
+    if ((cb = cbuf_new()) != NULL)
+        xml2api_path_1(*x, cb);
+    clixon_err(OE_XML, 0, "%s:%d: %s not in YANG order, sort the file first",
+               ss->ss_file, ss->ss_line, cb ? cbuf_get(cb) : xml_name(*x));
+    if (cb)
+        cbuf_free(cb);
+    return -1;
+}
+
+/*! Print a difference as a JSON line
+ */
+static int
+sd_emit(struct sd_ctx *sc,
+        enum diff_op   op,
+        cxobj         *x0,
+        cxobj         *x1)
+{
+    char      *path;
+    yang_stmt *y;
+
+    switch (op){
+    case DIFF_ADD:
+        sc->sc_adds++;
+        break;
+    case DIFF_DEL:
+        sc->sc_dels++;
+        break;
+    default:
+        sc->sc_changes++;
+        break;
+    }
+    if ((path = merge_path(x1?x1:x0)) == NULL)
+        return -1;
+    cbuf_reset(sc->sc_cb);
+    cprintf(sc->sc_cb, "{\"op\":\"%s\",\"path\":",
+            op==DIFF_ADD?"add":op==DIFF_DEL?"delete":"change");
+    bulk_json_str(sc->sc_cb, path);
+    y = xml_spec(x1?x1:x0);
+    if (op == DIFF_CHANGE &&
+        (y == NULL || (yang_keyword_get(y) != Y_ANYDATA && yang_keyword_get(y) != Y_ANYXML))){
+        cprintf(sc->sc_cb, ",\"old\":");
+        bulk_json_str(sc->sc_cb, xml_body(x0));
+        cprintf(sc->sc_cb, ",\"new\":");
+        bulk_json_str(sc->sc_cb, xml_body(x1));
+    }
+    cprintf(sc->sc_cb, "}");
+    fprintf(stdout, "%s\n", cbuf_get(sc->sc_cb));
+    free(path);
+    return 0;
+}
+
+/*! Diff children of two matched elements in lockstep
+ *
+ * Both streams are positioned after the records of the parents, and are read to and
+ * including the end tags of the parents.
+ * An ordered-by user entry with other keys than the entry at the same position is
+ * reported as deleted and added.
+ * @param[in]  sc   Streaming diff state
+ * @param[in]  s0   First stream
+ * @param[in]  s1   Second stream
+ * @param[in]  xp0  Parent record in first stream
+ * @param[in]  xp1  Parent record in second stream
+ */
+static int
+sd_level(struct sd_ctx    *sc,
+         struct sd_stream *s0,
+         struct sd_stream *s1,
+         cxobj            *xp0,
+         cxobj            *xp1)
+{
+    int        retval = -1;
+    cxobj     *x0 = NULL;
+    cxobj     *x1 = NULL;
+    cxobj     *xprev0 = NULL;
+    cxobj     *xprev1 = NULL;
+    yang_stmt *y;
+    char      *b0;
+    char      *b1;
+    int        c;
+
+    if (sd_advance(s0, xp0, sc->sc_yspec, &x0, &xprev0) < 0 ||
+        sd_advance(s1, xp1, sc->sc_yspec, &x1, &xprev1) < 0)
+        goto done;
+    while (x0 || x1){
+        if (x0 == NULL)
+            c = 1;
+        else if (x1 == NULL)
+            c = -1;
+        else if ((c = sd_cmp(x0, x1)) == 0){
+            y = xml_spec(x0);
+            if (sd_leaf(x0) != sd_leaf(x1) ||
+                (y && diff_user_ordered(y) && !diff_key_eq(x0, x1)))
+                c = 2; /* Replaced */
+        }
+        if (c < 0 || c == 2){
+            if (sd_emit(sc, DIFF_DEL, x0, NULL) < 0 || sd_skip(s0, x0) < 0)
+                goto done;
+        }
+        if (c > 0){
+            if (sd_emit(sc, DIFF_ADD, NULL, x1) < 0 || sd_skip(s1, x1) < 0)
+                goto done;
+        }
+        if (c == 0){
+            if (sd_leaf(x0)){
+                b0 = xml_body(x0);
+                b1 = xml_body(x1);
+                if (strcmp(b0?b0:"", b1?b1:"") != 0 &&
+                    sd_emit(sc, DIFF_CHANGE, x0, x1) < 0)
+                    goto done;
+            }
+            else if (sd_level(sc, s0, s1, x0, x1) < 0)
+                goto done;
+        }
+        if ((c <= 0 || c == 2) &&
+            sd_advance(s0, xp0, sc->sc_yspec, &x0, &xprev0) < 0)
+            goto done;
+        if (c >= 0 &&
+            sd_advance(s1, xp1, sc->sc_yspec, &x1, &xprev1) < 0)
+            goto done;
+    }
+    retval = 0;
+ done:
+    if (xprev0)
+        xml_purge(xprev0);
+    if (xprev1)
+        xml_purge(xprev1);
+    if (x0)
+        xml_purge(x0);
+    if (x1)
+        xml_purge(x1);
+    return retval;
+}
+
+/*! Diff two XML files sorted in YANG order without building the trees
+ *
+ * Prints a JSON line per difference on stdout, and totals on stderr
+ * @param[in]  yspec  Yang spec
+ * @param[in]  file0  First file
+ * @param[in]  file1  Second file
+ */
+static int
+stream_diff(yang_stmt *yspec,
+            char      *file0,
+            char      *file1)
+{
+    int              retval = -1;
+    struct sd_ctx    sc = {0,};
+    struct sd_stream ss[2] = {{0,},};
+    char            *files[2] = {file0, file1};
+    struct timeval   t0;
+    struct timeval   t1;
+    struct timeval   td;
+    int              i;
+
+    gettimeofday(&t0, NULL);
+    sc.sc_yspec = yspec;
+    if ((sc.sc_cb = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    for (i=0; i<2; i++){
+        ss[i].ss_file = files[i];
+        ss[i].ss_line = 1;
+        if ((ss[i].ss_f = fopen(files[i], "r")) == NULL){
+            clixon_err(OE_UNIX, errno, "fopen(%s)", files[i]);
+            goto done;
+        }
+        if ((ss[i].ss_name = cbuf_new()) == NULL ||
+            (ss[i].ss_text = cbuf_new()) == NULL){
+            clixon_err(OE_UNIX, errno, "cbuf_new");
+            goto done;
+        }
+        if ((ss[i].ss_attrs = cvec_new(0)) == NULL){
+            clixon_err(OE_UNIX, errno, "cvec_new");
+            goto done;
+        }
+        if ((ss[i].ss_top = xml_new("top", NULL, CX_ELMNT)) == NULL)
+            goto done;
+    }
+    if (sd_level(&sc, &ss[0], &ss[1], ss[0].ss_top, ss[1].ss_top) < 0)
+        goto done;
+    gettimeofday(&t1, NULL);
+    timersub(&t1, &t0, &td);
+    fprintf(stderr, "stream: add: %d delete: %d change: %d nodes: %d %d time: %lu.%06lu\n",
+            sc.sc_adds, sc.sc_dels, sc.sc_changes, ss[0].ss_nodes, ss[1].ss_nodes,
+            td.tv_sec, td.tv_usec);
+    retval = 0;
+ done:
+    for (i=0; i<2; i++){
+        if (ss[i].ss_f)
+            fclose(ss[i].ss_f);
+        if (ss[i].ss_name)
+            cbuf_free(ss[i].ss_name);
+        if (ss[i].ss_attrs)
+            cvec_free(ss[i].ss_attrs);
+        if (ss[i].ss_text)
+            cbuf_free(ss[i].ss_text);
+        if (ss[i].ss_top)
+            xml_free(ss[i].ss_top);
+    }
+    if (sc.sc_cb)
+        cbuf_free(sc.sc_cb);
+    return retval;
+}
+
+/*! Count element nodes of a tree
+ */
+static int
+xml_nodes_count(cxobj *x)
+{
+    cxobj *xc;
+    int    n = 1;
+
+    xc = NULL;
+    while ((xc = xml_child_each(x, xc, CX_ELMNT)) != NULL)
+        n += xml_nodes_count(xc);
+    return n;
+}
+
+/*! Time the diff with merge-join of sorted children and with search per child
+ *
+ * And with merge-join skipping equal subtrees if Merkle hashes are given, and in
+ * parallel (with hashes if given) if more than one worker.
+ * No edit-config is built, only the differences are counted
+ */
+static int
+diff_bench(cxobj            *x0,
+           cxobj            *x1,
+           struct diff_hmap *hm,
+           int               workers)
+{
+    int             retval = -1;
+    struct diff_ctx dc;
+    struct timeval  t0;
+    struct timeval  t1;
+    struct timeval  td;
+    int             match;
+
+    fprintf(stdout, "nodes: x0: %d x1: %d\n", xml_nodes_count(x0), xml_nodes_count(x1));
+    for (match=0; match<4; match++){
+        if ((match == 2 && hm == NULL) || (match == 3 && workers < 2))
+            continue;
+        memset(&dc, 0, sizeof(dc));
+        dc.dc_match = match == 1;
+        if (match >= 2)
+            dc.dc_hash = hm;
+        gettimeofday(&t0, NULL);
+        if (match == 3){
+            if (xml_diff_parallel(&dc, x0, x1, workers) < 0)
+                goto done;
+        }
+        else if (xml_diff(&dc, x0, x1) < 0)
+            goto done;
+        gettimeofday(&t1, NULL);
+        timersub(&t1, &t0, &td);
+        fprintf(stdout, "%s: time: %lu.%06lu add: %d delete: %d change: %d move: %d skipped: %d\n",
+                match==0?"merge":match==1?"search":match==2?"merkle":"parallel",
+                td.tv_sec, td.tv_usec,
+                dc.dc_adds, dc.dc_dels, dc.dc_changes, dc.dc_moves, dc.dc_skipped);
+        if (dc.dc_path)
+            free(dc.dc_path);
+        if (dc.dc_out)
+            free(dc.dc_out);
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+
+/* Number of parses of each format in parse benchmark */
+#define DIFF_PARSE_RUNS 10
+
+/*! Time parsing of the same data in XML, JSON and TEXT
+ *
+ * The tree is written in each format to a temporary file, which is then parsed
+ * DIFF_PARSE_RUNS times. Validation is not included.
+ * @param[in]  h      Clixon handle
+ * @param[in]  xt     Parsed tree
+ * @param[in]  yspec  Yang spec
+ */
+static int
+diff_parse_bench(clixon_handle h,
+                 cxobj        *xt,
+                 yang_stmt    *yspec)
+{
+    int              retval = -1;
+    enum format_enum formats[] = {FORMAT_XML, FORMAT_JSON, FORMAT_TEXT};
+    char            *names[] = {"xml", "json", "text"};
+    FILE            *f = NULL;
+    cxobj           *x = NULL;
+    struct timeval   t0;
+    struct timeval   t1;
+    struct timeval   td;
+    long             size;
+    double           usec;
+    int              i;
+    int              r;
+
+    for (i=0; i<sizeof(formats)/sizeof(*formats); i++){
+        if ((f = tmpfile()) == NULL){
+            clixon_err(OE_UNIX, errno, "tmpfile");
+            goto done;
+        }
+        switch (formats[i]){
+        case FORMAT_XML:
+            if (clixon_xml2file(f, xt, 0, 1, NULL, fprintf, 1, 0) < 0)
+                goto done;
+            break;
+        case FORMAT_JSON:
+            if (clixon_json2file(f, xt, 1, fprintf, 1, 0) < 0)
+                goto done;
+            break;
+        default:
+            if (clixon_text2file(f, xt, 0, fprintf, 1, 0) < 0)
+                goto done;
+            break;
+        }
+        fflush(f);
+        size = ftell(f);
+        gettimeofday(&t0, NULL);
+        for (r=0; r<DIFF_PARSE_RUNS; r++){
+            rewind(f);
+            if (diff_parse(h, f, formats[i], yspec, &x) < 0)
+                goto done;
+            xml_free(x);
+            x = NULL;
+        }
+        gettimeofday(&t1, NULL);
+        timersub(&t1, &t0, &td);
+        usec = (td.tv_sec*1000000.0 + td.tv_usec)/DIFF_PARSE_RUNS;
+        fprintf(stdout, "parse: %-4s size: %ld time: %lu.%06lu per parse: %.0f us rate: %.1f MB/s\n",
+                names[i], size, td.tv_sec, td.tv_usec, usec,
+                usec > 0 ? size/usec : 0.0);
+        fclose(f);
+        f = NULL;
+    }
+    retval = 0;
+ done:
+    if (x)
+        xml_free(x);
+    if (f)
+        fclose(f);
+    return retval;
+}
+
 static int
 usage(char *argv0)
 {
@@ -112,12 +3402,24 @@ usage(char *argv0)
             "\t-h \t\tHelp\n"
             "\t-D <level> \tDebug\n"
             "\t-l <s|e|o> \tLog on (s)yslog, std(e)rr, std(o)ut (stderr is default)\n"
-            "\t-f <file>\tinput file (can be 2 or 3)\n"
-            "\t-i <format>\tInput file format: (xml|json|text) default:xml\n"
-            "\t-o <format>\tOutput format: (xml|json|text) default:xml\n"
+            "\t-f <file>\tinput file (can be 2, or 3: base, candidate, running, or 1 with -b)\n"
+            "\t-i <format>\tInput file format: (xml|json|text|auto) default:xml\n"
+            "\t-o <format>\tOutput format of edit-config: (xml|json|text) default:xml\n"
             "\t-y <filename> \tYang filename or dir (load all files)\n"
             "\t-Y <dir> \tYang dirs (can be several)\n"
             "\t-u \t\tTreat unknown XML as anydata\n"
+            "\t-B \t\tBenchmark diff of two files, or rebase and merge of three files,\n"
+            "\t\t\tor xml, json and text parsing of the data of one file\n"
+            "\t-m \t\tSkip equal subtrees in diff using Merkle hashes\n"
+            "\t-H <file>\tImport hashes of first file from, or export to, file (implies -m)\n"
+            "\t-j <nr>\tDiff top-level subtrees in parallel with nr threads\n"
+            "\t-M \t\tMerge candidate into running (three files): merged tree on stdout,\n"
+            "\t\t\tconflicts and ok/conflict verdict on stderr\n"
+            "\t-b <dir|file>\tBulk diff of one -f baseline against all files in dir, or listed in file\n"
+            "\t\t\tJSON line of changes per file, -j is number of worker processes\n"
+            "\t-S \t\tStreaming diff of two XML files in YANG order, JSON line per change\n"
+            "\t\t\tUnknown elements and lists without keys are matched by position,\n"
+            "\t\t\tattributes other than xmlns are only compared in anydata\n"
             ,
             argv0);
     exit(0);
@@ -133,7 +3435,6 @@ main(int    argc,
     int              logdst = CLIXON_LOG_STDERR;
     char            *yang_file_dir = NULL;
     yang_stmt       *yspec = NULL;
-    cxobj           *xerr = NULL; /* malloced must be freed */
     clixon_handle    h;
     struct stat      st;
     cxobj           *xcfg = NULL;
@@ -141,13 +3442,28 @@ main(int    argc,
     cvec            *nsc = NULL;
     int              dbg = 0;
     char           **filenames = NULL;
-    FILE           **fps = NULL;
     cxobj          **xts = NULL;
     int              fnr = 0;
     enum format_enum format_in = FORMAT_XML;
     enum format_enum format_out = FORMAT_XML;
+    enum format_enum format;
+    FILE            *fp;
     int              i;
     int              conflict;
+    int              bench = 0;
+    int              merkle = 0;
+    char            *hashfile = NULL;
+    struct diff_hmap hm = {0,};
+    int              workers = 1;
+    int              merge = 0;
+    char            *bulk = NULL;
+    int              stream = 0;
+    int              detect = 0;
+    struct merge_ctx mg = {0,};
+    struct timeval   t0;
+    struct timeval   t1;
+    struct timeval   td;
+    uint64_t         hash;
     int              ret;
 
     /* Initialize clixon handle */
@@ -181,21 +3497,18 @@ main(int    argc,
                 clixon_err(OE_UNIX, errno, "realloc");
                 goto done;
             }
-            if ((fps = realloc(fps, sizeof(FILE*)*(fnr+1))) == NULL){
-                clixon_err(OE_UNIX, errno, "realloc");
-                goto done;
-            }
             if ((xts = realloc(xts, sizeof(cxobj*)*(fnr+1))) == NULL){
                 clixon_err(OE_UNIX, errno, "realloc");
                 goto done;
             }
             filenames[fnr] = optarg;
-            fps[fnr] = NULL;
             xts[fnr] = NULL;
             fnr++;
             break;
         case 'i': /* input format */
-            if ((int)(format_in = format_str2int(optarg)) < 0){
+            if (strcmp(optarg, "auto") == 0)
+                detect++;
+            else if ((int)(format_in = format_str2int(optarg)) < 0){
                 clixon_err(OE_CFG, 0, "No such format %s", optarg);
                 goto done;
             }
@@ -218,14 +3531,54 @@ main(int    argc,
                 goto done;
             xml_bind_yang_unknown_anydata(1);
             break;
+        case 'B':
+            bench++;
+            break;
+        case 'm':
+            merkle++;
+            break;
+        case 'H':
+            hashfile = optarg;
+            merkle++;
+            break;
+        case 'j':
+            if ((workers = atoi(optarg)) < 1)
+                usage(argv[0]);
+            break;
+        case 'M':
+            merge++;
+            break;
+        case 'b':
+            bulk = optarg;
+            break;
+        case 'S':
+            stream++;
+            break;
         default:
             usage(argv[0]);
             break;
         }
-    if (fnr < 2 || fnr > 3){
-        fprintf(stderr, "Error: Two or three -f <input-files> required\n");
+    if (bulk ? fnr != 1 : (fnr < (bench?1:2) || fnr > 3)){
+        fprintf(stderr, "Error: Two or three -f <input-files>, or one with -b or -B, required\n");
+        goto done;
+    }
+    if (stream && (fnr != 2 || (format_in != FORMAT_XML && !detect))){
+        fprintf(stderr, "Error: -S requires two XML -f <input-files>\n");
         goto done;
     }
+    for (i=0; stream && detect && i<fnr; i++){
+        if ((fp = fopen(filenames[i], "r")) == NULL){
+            clixon_err(OE_UNIX, errno, "fopen(%s)", filenames[i]);
+            goto done;
+        }
+        format = diff_format_detect(fp);
+        fclose(fp);
+        if (format != FORMAT_XML){
+            fprintf(stderr, "Error: -S requires XML, %s is %s\n",
+                    filenames[i], format_int2str(format));
+            goto done;
+        }
+    }
     if (yang_file_dir == NULL){
         fprintf(stderr, "Error: -y required\n");
         goto done;
@@ -251,79 +3604,102 @@ main(int    argc,
                 goto done;
         }
     }
-    /* 2. Open files */
-    for (i=0; i<fnr; i++){
-        if ((fps[i] = fopen(filenames[i], "r")) == NULL){
-            clixon_err(OE_YANG, errno, "open(%s)", filenames[i]);
+    /* 2. Parse and validate files, the streaming diff reads the files itself */
+    for (i=0; i<fnr && !stream; i++)
+        if (diff_parse_file(h, filenames[i], format_in, detect, yspec, &xts[i]) < 0)
             goto done;
-        }
-        /* 3. Parse data according to format */
-        switch (format_in){
-        case FORMAT_XML:
-            if ((ret = clixon_xml_parse_file(fps[i],
-                                             YB_MODULE,
-                                             yspec,
-                                            &xts[i],
-                                            &xerr)) < 0)
-                goto done;
-            break;
-        case FORMAT_TEXT:
-            if ((ret = clixon_text_syntax_parse_file(fps[i],
-                                                     YB_MODULE,
-                                                     yspec,
-                                                     &xts[i],
-                                                     &xerr)) < 0)
-                goto done;
-            break;
-        case FORMAT_JSON:
-            if ((ret = clixon_json_parse_file(fps[i],
-                                              1,
-                                              YB_MODULE,
-                                              yspec,
-                                              &xts[i],
-                                              &xerr)) < 0)
-                goto done;
-        default:
-            clixon_err(OE_XML, 0, "Unsupported format");
+    if (merkle && !stream && fnr < 3){
+        gettimeofday(&t0, NULL);
+        ret = 0;
+        if (hashfile &&
+            (ret = diff_hash_import(hashfile, filenames[0], &hm, xts[0])) < 0)
             goto done;
-            break;
-        }
-        if (ret == 0){
-            clixon_err_netconf(h, OE_XML, 0, xerr, "util_xml");
+        if (diff_hash(&hm, xts[0], &hash) < 0)
             goto done;
-        }
-        /* 3. Validate data */
-        if (validate_tree(h, xts[i], yspec) < 0)
+        if (fnr == 2 && diff_hash(&hm, xts[1], &hash) < 0)
+            goto done;
+        gettimeofday(&t1, NULL);
+        timersub(&t1, &t0, &td);
+        fprintf(stderr, "merkle: hash time: %lu.%06lu%s\n",
+                td.tv_sec, td.tv_usec, ret?" (x0 imported)":"");
+        if (hashfile && ret == 0 &&
+            diff_hash_export(hashfile, filenames[0], &hm, xts[0]) < 0)
+            goto done;
+    }
+    if (stream){
+        if (stream_diff(yspec, filenames[0], filenames[1]) < 0)
+            goto done;
+    }
+    else if (bulk){
+        if (bulk_diff(h, bulk, xts[0], yspec, format_in, detect, merkle?&hm:NULL, workers) < 0)
+            goto done;
+    }
+    else if (fnr == 1){
+        if (diff_parse_bench(h, xts[0], yspec) < 0)
             goto done;
     }
-    if (fnr == 2){
+    else if (fnr == 2){
         ret = xml_tree_equal(xts[0], xts[1]);
         if (ret == 0)
             fprintf(stderr, "x0 = x1\n");
         else
             fprintf(stderr, "x0 != x1\n");
+        if (bench){
+            if (diff_bench(xts[0], xts[1], merkle?&hm:NULL, workers) < 0)
+                goto done;
+        }
+        /* Edit-config transforming x0 into x1 */
+        else if (diff_edit_print(xts[0], xts[1], format_out, merkle?&hm:NULL, workers) < 0)
+            goto done;
     }
     else if (fnr == 3){
-        conflict = 0;
-        if (xml_rebase(h, xts[0], xts[1], xts[2], &conflict, NULL, NULL) < 0)
-            goto done;
-        if (conflict == 0)
-            fprintf(stdout, "ok\n");
-        else
-            fprintf(stdout, "conflict\n");
+        /* Own merge before xml_rebase, which may modify the trees */
+        if (merge || bench){
+            if (merge && (mg.mg_cb = cbuf_new()) == NULL){
+                clixon_err(OE_UNIX, errno, "cbuf_new");
+                goto done;
+            }
+            if (merge3(xts[0], xts[1], xts[2], &mg) < 0)
+                goto done;
+        }
+        /* With -M the merge gives the verdict, xml_rebase only runs in the benchmark */
+        if (!merge || bench){
+            conflict = 0;
+            gettimeofday(&t0, NULL);
+            if (xml_rebase(h, xts[0], xts[1], xts[2], &conflict, NULL, NULL) < 0)
+                goto done;
+            gettimeofday(&t1, NULL);
+            timersub(&t1, &t0, &td);
+            if (bench){
+                fprintf(stdout, "rebase: %lu.%06lu %s\n",
+                        td.tv_sec, td.tv_usec, conflict?"conflict":"ok");
+                fprintf(stdout, "merge: collect: %lu.%06lu apply: %lu.%06lu\n",
+                        mg.mg_tcollect.tv_sec, mg.mg_tcollect.tv_usec,
+                        mg.mg_tapply.tv_sec, mg.mg_tapply.tv_usec);
+            }
+            else if (conflict == 0)
+                fprintf(stdout, "ok\n");
+            else
+                fprintf(stdout, "conflict\n");
+        }
+        /* Listing and verdict on stderr, so stdout is only the merged tree */
+        if (merge){
+            fprintf(stderr, "%s", cbuf_get(mg.mg_cb));
+            fprintf(stderr, "%s\n", mg.mg_conflicts?"conflict":"ok");
+            if (!bench && diff_tree_print(stdout, mg.mg_xm, format_out) < 0)
+                goto done;
+        }
+        if (merge || bench)
+            fprintf(stderr, "merge: running changes: %d applied: %d same: %d conflicts: %d\n",
+                    mg.mg_n, mg.mg_applied, mg.mg_same, mg.mg_conflicts);
     }
     retval = 0;
  done:
+    hmap_free(&hm);
+    merge_free(&mg);
     yang_exit(h);
     if (filenames)
         free(filenames);
-    if (fps){
-        for (i=0; i<fnr; i++){
-            if (fps[i])
-                fclose(fps[i]);
-        }
-        free(fps);
-    }
     if (xts){
         for (i=0; i<fnr; i++){
             if (xts[i])
@@ -337,8 +3713,6 @@ main(int    argc,
         cbuf_free(cbret);
     if (xcfg)
         xml_free(xcfg);
-    if (xerr)
-        xml_free(xerr);
     if (cb)
         cbuf_free(cb);
     if (h)
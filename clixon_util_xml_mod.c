@@ -43,6 +43,13 @@
   *   Example: xb := <b><c/></b>; xs := <b><d/></b>
   *        Result is : xb = <b><c/><d/></b>
   * - Merging trees: -o merge -b <base> -x <2nd> -p <path>
+  * - Edit script: -f <basefile> -e <script>
+  *   Each line of the script is an operation: <op>TAB<xpath>TAB<xml>, where xpath "-" is top.
+  *   The base tree is parsed once and all operations are applied in order.
+  * - Incremental sort: -I
+  *   Insert, merge and parent operations keep the base tree in YANG order by inserting
+  *   new nodes in place, and only the modified parents are verified. -C compares with
+  *   the operation followed by a full sort.
   */
 
 #ifdef HAVE_CONFIG_H
@@ -59,6 +66,8 @@
 #include <syslog.h>
 #include <fcntl.h>
 #include <signal.h>
+#include <inttypes.h>
+#include <sys/time.h>
 
 /* cligen */
 #include <cligen/cligen.h>
@@ -67,7 +76,7 @@
 #include "clixon/clixon.h"
 
 /* Command line options passed to getopt(3) */
-#define UTIL_XML_MOD_OPTS "hD:o:y:Y:b:x:p:s"
+#define UTIL_XML_MOD_OPTS "hD:o:y:Y:b:x:p:sf:e:tIC"
 
 enum opx{
     OPX_ERROR = -1,
@@ -89,6 +98,484 @@ opx_str2int(char *opstr)
     return clicon_str2int(opx_map, opstr);
 }
 
+/*! Latency samples of an operation in an edit script
+ */
+struct mod_stat {
+    char     *ms_name; /* Operation name */
+    uint64_t *ms_vec;  /* Latency samples in usecs */
+    int       ms_len;  /* Number of samples */
+};
+
+static int
+uint64_cmp(const void *a,
+           const void *b)
+{
+    uint64_t ia = *(uint64_t*)a;
+    uint64_t ib = *(uint64_t*)b;
+
+    return ia < ib ? -1 : ia > ib;
+}
+
+/*! Add a latency sample
+ */
+static int
+mod_stat_add(struct mod_stat *ms,
+             uint64_t         usec)
+{
+    if ((ms->ms_len % 1024) == 0 &&
+        (ms->ms_vec = realloc(ms->ms_vec, (ms->ms_len+1024)*sizeof(uint64_t))) == NULL){
+        clixon_err(OE_UNIX, errno, "realloc");
+        return -1;
+    }
+    ms->ms_vec[ms->ms_len++] = usec;
+    return 0;
+}
+
+/*! Sort samples and print nr of ops, total, p50, p99 and max latency
+ */
+static void
+mod_stat_print(FILE            *f,
+               struct mod_stat *ms)
+{
+    uint64_t total = 0;
+    int      i;
+
+    if (ms->ms_len == 0)
+        return;
+    qsort(ms->ms_vec, ms->ms_len, sizeof(uint64_t), uint64_cmp);
+    for (i=0; i<ms->ms_len; i++)
+        total += ms->ms_vec[i];
+    fprintf(f, "%-6s ops: %-8d total: %-10" PRIu64 " p50: %-8" PRIu64 " p99: %-8" PRIu64 " max: %" PRIu64 " usec\n",
+            ms->ms_name, ms->ms_len, total,
+            ms->ms_vec[ms->ms_len/2],
+            ms->ms_vec[(int)(0.99*ms->ms_len)],
+            ms->ms_vec[ms->ms_len-1]);
+}
+
+/*! Parents modified by incremental operations, to be verified
+ */
+struct mod_touch {
+    cxobj **mt_vec;
+    int     mt_len;
+    int     mt_resorted; /* Parents not in order when verified */
+};
+
+/*! Add a modified parent, once
+ */
+static int
+mod_touch_add(struct mod_touch *mt,
+              cxobj            *xp)
+{
+    if (xml_flag(xp, XML_FLAG_MARK))
+        return 0;
+    if ((mt->mt_len % 64) == 0 &&
+        (mt->mt_vec = realloc(mt->mt_vec, (mt->mt_len+64)*sizeof(cxobj*))) == NULL){
+        clixon_err(OE_UNIX, errno, "realloc");
+        return -1;
+    }
+    xml_flag_set(xp, XML_FLAG_MARK);
+    mt->mt_vec[mt->mt_len++] = xp;
+    return 0;
+}
+
+/*! Verify the order of children of modified parents, and sort those not in order
+ */
+static int
+mod_touch_verify(struct mod_touch *mt)
+{
+    cxobj *xp;
+    int    i;
+
+    for (i=0; i<mt->mt_len; i++){
+        xp = mt->mt_vec[i];
+        xml_flag_reset(xp, XML_FLAG_MARK);
+        if (xml_sort_verify(xp, NULL) < 0){
+            if (xml_sort(xp) < 0)
+                return -1;
+            mt->mt_resorted++;
+        }
+    }
+    mt->mt_len = 0;
+    return 0;
+}
+
+/*! Insert a new subtree under a parent in YANG order
+ *
+ * The subtree is sorted, and then inserted in place by xml_insert, using binary search
+ * of system ordered children. Ordered-by user entries are inserted last.
+ * @param[in]  xp  Parent, children in YANG order
+ * @param[in]  xn  New subtree, not linked
+ * @param[in]  mt  Modified parents
+ */
+static int
+mod_insert_sorted(cxobj            *xp,
+                  cxobj            *xn,
+                  struct mod_touch *mt)
+{
+    if (xml_sort_recurse(xn) < 0)
+        return -1;
+    if (xml_insert(xp, xn, INS_LAST, NULL, NULL) < 0)
+        return -1;
+    return mod_touch_add(mt, xp);
+}
+
+/*! Merge children of x1 into x0 keeping YANG order
+ *
+ * Matched leafs get the value of x1, matched anydata is replaced, and new nodes are
+ * inserted in place. Both trees are bound to YANG and x0 is in YANG order.
+ * As xml_merge, a node of x1 without YANG spec is invalid.
+ * @param[in]  x0      Base subtree
+ * @param[in]  x1      Subtree to merge
+ * @param[in]  mt      Modified parents
+ * @param[out] reason  If retval is 0, malloced reason, free with free()
+ * @retval     1       OK
+ * @retval     0       Invalid, reason set
+ * @retval    -1       Error
+ */
+static int
+mod_merge_sorted(cxobj            *x0,
+                 cxobj            *x1,
+                 struct mod_touch *mt,
+                 char            **reason)
+{
+    cxobj     *x1c;
+    cxobj     *x0c;
+    cxobj     *xn;
+    cxobj     *xb;
+    yang_stmt *yc;
+    char      *b1;
+    int        ret;
+
+    x1c = NULL;
+    while ((x1c = xml_child_each(x1, x1c, CX_ELMNT)) != NULL){
+        if ((yc = xml_spec(x1c)) == NULL){
+            if ((*reason = strdup("XML node has no corresponding yang specification (Invalid XML or wrong Yang spec?)")) == NULL){
+                clixon_err(OE_UNIX, errno, "strdup");
+                return -1;
+            }
+            return 0;
+        }
+        x0c = NULL;
+        if (match_base_child(x0, x1c, yc, &x0c) < 0)
+            return -1;
+        if (x0c != NULL &&
+            (yang_keyword_get(yc) == Y_ANYDATA || yang_keyword_get(yc) == Y_ANYXML)){
+            if (xml_purge(x0c) < 0)
+                return -1;
+            x0c = NULL;
+        }
+        if (x0c == NULL){
+            if ((xn = xml_dup(x1c)) == NULL ||
+                mod_insert_sorted(x0, xn, mt) < 0)
+                return -1;
+            continue;
+        }
+        if (yang_keyword_get(yc) == Y_LEAF_LIST)
+            continue; /* Matched by value */
+        if (yang_keyword_get(yc) == Y_LEAF){
+            if ((b1 = xml_body(x1c)) == NULL)
+                continue;
+            if ((xb = xml_body_get(x0c)) == NULL &&
+                (xb = xml_new("body", x0c, CX_BODY)) == NULL)
+                return -1;
+            if (xml_value_set(xb, b1) < 0)
+                return -1;
+            continue;
+        }
+        if ((ret = mod_merge_sorted(x0c, x1c, mt, reason)) <= 0)
+            return ret;
+    }
+    return 1;
+}
+
+/*! Apply one operation on a base tree
+ *
+ * @param[in]  h      Clixon handle
+ * @param[in]  yspec  YANG spec
+ * @param[in]  x0     Base tree
+ * @param[in]  opx    Operation
+ * @param[in]  xpath  Xpath to where in base and XML, or NULL for top
+ * @param[in]  x1str  XML of operation
+ * @param[in]  mt     Keep YANG order and add modified parents, or NULL
+ * @param[in]  sort   Sort new subtrees and the modified parent, if not mt
+ * @param[out] xbp    Base subtree modified by the operation
+ */
+static int
+mod_apply(clixon_handle     h,
+          yang_stmt        *yspec,
+          cxobj            *x0,
+          enum opx          opx,
+          char             *xpath,
+          char             *x1str,
+          struct mod_touch *mt,
+          int               sort,
+          cxobj           **xbp)
+{
+    int    retval = -1;
+    cxobj *x1 = NULL;
+    cxobj *xb = NULL;
+    cxobj *xi = NULL;
+    cxobj *xi1 = NULL;
+    cxobj *xerr = NULL;
+    char  *reason = NULL;
+    cxobj **xvec = NULL;
+    int    xlen = 0;
+    int    n0;
+    int    i;
+    int    ret;
+
+    /* Get base subtree by xpath */
+    if (xpath == NULL)
+        xb = x0;
+    else if ((xb = xpath_first(x0, NULL, "%s", xpath)) == NULL){
+        clixon_err(OE_XML, 0, "xpath: %s not found in x0", xpath);
+        goto done;
+    }
+    if (clixon_debug_get()){
+        clixon_debug(CLIXON_DBG_DEFAULT, "xb:");
+        xml_print(stderr, xb);
+    }
+    switch (opx){
+    case OPX_PARENT:
+        n0 = xml_child_nr(xb);
+        /* Parse insert XML */
+        if ((ret = clixon_xml_parse_string(x1str, YB_PARENT, yspec, &xb, &xerr)) < 0){
+            clixon_err(OE_XML, 0, "Parsing insert xml: %s", x1str);
+            goto done;
+        }
+        if (ret == 0){
+            clixon_err_netconf(h, OE_XML, 0, xerr, "Parsing secondary xml");
+            goto done;
+        }
+        /* Unlink new element children, parsed last, and insert them in place */
+        if (mt){
+            if ((xvec = calloc(xml_child_nr(xb) - n0 + 1, sizeof(cxobj*))) == NULL){
+                clixon_err(OE_UNIX, errno, "calloc");
+                goto done;
+            }
+            for (i=n0; i<xml_child_nr(xb); i++)
+                if (xml_type(xml_child_i(xb, i)) == CX_ELMNT)
+                    xvec[xlen++] = xml_child_i(xb, i);
+            for (i=0; i<xlen; i++)
+                if (xml_rm(xvec[i]) < 0){
+                    xlen = i; /* Free only unlinked */
+                    goto done;
+                }
+            for (i=0; i<xlen; i++){
+                xi1 = xvec[i];
+                xvec[i] = NULL;
+                if (mod_insert_sorted(xb, xi1, mt) < 0)
+                    goto done;
+            }
+        }
+        else if (sort){
+            for (i=n0; i<xml_child_nr(xb); i++)
+                if (xml_sort_recurse(xml_child_i(xb, i)) < 0)
+                    goto done;
+            if (xml_sort(xb) < 0)
+                goto done;
+        }
+        break;
+    case OPX_MERGE:
+        /* Parse merge XML */
+        if ((ret = clixon_xml_parse_string(x1str, YB_MODULE, yspec, &x1, &xerr)) < 0){
+            clixon_err(OE_XML, 0, "Parsing insert xml: %s", x1str);
+            goto done;
+        }
+        if (ret == 0){
+            clixon_err_netconf(h, OE_XML, 0, xerr, "Parsing secondary xml");
+            goto done;
+        }
+        if (xpath == NULL)
+            xi = x1;
+        else if ((xi = xpath_first(x1, NULL, "%s", xpath)) == NULL){
+            clixon_err(OE_XML, 0, "xpath: %s not found in xi", xpath);
+            goto done;
+        }
+        if (mt)
+            ret = mod_merge_sorted(xb, xi, mt, &reason);
+        else
+            ret = xml_merge(xb, xi, yspec, &reason);
+        if (ret < 0)
+            goto done;
+        if (ret == 0){
+            clixon_err(OE_XML, 0, "%s", reason);
+            goto done;
+        }
+        /* Merge may add nodes at any level below the base subtree */
+        if (sort && mt == NULL && xml_sort_recurse(xb) < 0)
+            goto done;
+        break;
+    case OPX_INSERT:
+        /* Parse insert XML */
+        if ((ret = clixon_xml_parse_string(x1str, YB_MODULE, yspec, &x1, &xerr)) < 0){
+            clixon_err(OE_XML, 0, "Parsing insert xml: %s", x1str);
+            goto done;
+        }
+        if (ret == 0){
+            clixon_err_netconf(h, OE_XML, 0, xerr, "Parsing secondary xml");
+            goto done;
+        }
+        /* Get secondary subtree by xpath */
+        if (xpath == NULL)
+            xi = x1;
+        else if ((xi = xpath_first(x1, NULL, "%s", xpath)) == NULL){
+            clixon_err(OE_XML, 0, "xpath: %s not found in xi", xpath);
+            goto done;
+        }
+
+        /* Find first element child of secondary */
+        if ((xi1 = xml_child_i_type(xi, 0, CX_ELMNT)) == NULL){
+            clixon_err(OE_XML, 0, "xi has no element child");
+            goto done;
+        }
+        /* Remove it from parent */
+        if (xml_rm(xi1) < 0)
+            goto done;
+        if (mt){
+            if (mod_insert_sorted(xb, xi1, mt) < 0)
+                goto done;
+        }
+        else {
+            if (sort && xml_sort_recurse(xi1) < 0)
+                goto done;
+            if (xml_insert(xb, xi1, INS_LAST, NULL, NULL) < 0)
+                goto done;
+            if (sort && xml_sort(xb) < 0)
+                goto done;
+        }
+        break;
+    default:
+        clixon_err(OE_XML, 0, "Unknown operation");
+        goto done;
+    }
+    *xbp = xb;
+    retval = 0;
+ done:
+    if (xvec){
+        for (i=0; i<xlen; i++)
+            if (xvec[i])
+                xml_free(xvec[i]);
+        free(xvec);
+    }
+    if (x1)
+        xml_free(x1);
+    if (xerr)
+        xml_free(xerr);
+    if (reason)
+        free(reason);
+    return retval;
+}
+
+/*! Apply an edit script on a base tree
+ *
+ * Each line is an operation: <op>TAB<xpath>TAB<xml>, where xpath - is top.
+ * Fields are separated by tabs, so the xpath may contain spaces.
+ * Empty lines and lines starting with # are skipped.
+ * Latency of each operation type is printed on stderr.
+ * @param[in]  h         Clixon handle
+ * @param[in]  yspec     YANG spec
+ * @param[in]  x0        Base tree
+ * @param[in]  filename  Edit script
+ * @param[in]  touched   Sort modified parent, or verify modified parents, after each operation
+ * @param[in]  mt        Keep YANG order and add modified parents, or NULL
+ */
+static int
+mod_script(clixon_handle     h,
+           yang_stmt        *yspec,
+           cxobj            *x0,
+           char             *filename,
+           int               touched,
+           struct mod_touch *mt)
+{
+    int             retval = -1;
+    FILE           *f = NULL;
+    char           *line = NULL;
+    size_t          linelen = 0;
+    ssize_t         len;
+    int             lineno = 0;
+    char           *opstr;
+    char           *xpath;
+    char           *x1str;
+    enum opx        opx;
+    cxobj          *xb;
+    struct mod_stat ms[] = {{"insert", NULL, 0}, {"merge", NULL, 0}, {"parent", NULL, 0}};
+    struct timeval  t0;
+    struct timeval  t1;
+    struct timeval  td;
+    int             i;
+
+    if ((f = fopen(filename, "r")) == NULL){
+        clixon_err(OE_UNIX, errno, "fopen(%s)", filename);
+        goto done;
+    }
+    while ((len = getline(&line, &linelen, f)) >= 0){
+        lineno++;
+        if (len && line[len-1] == '\n')
+            line[--len] = '\0';
+        if (len == 0 || line[0] == '#')
+            continue;
+        opstr = line;
+        if ((xpath = strchr(opstr, '\t')) == NULL ||
+            (*xpath++ = '\0', x1str = strchr(xpath, '\t')) == NULL){
+            clixon_err(OE_XML, 0, "%s:%d: Expected <op>TAB<xpath>TAB<xml>", filename, lineno);
+            goto done;
+        }
+        *x1str++ = '\0';
+        if ((opx = opx_str2int(opstr)) == OPX_ERROR){
+            clixon_err(OE_XML, 0, "%s:%d: No such operation %s", filename, lineno, opstr);
+            goto done;
+        }
+        if (strcmp(xpath, "-") == 0)
+            xpath = NULL;
+        gettimeofday(&t0, NULL);
+        if (mod_apply(h, yspec, x0, opx, xpath, x1str, mt, touched, &xb) < 0){
+            fprintf(stderr, "%s:%d: %s failed\n", filename, lineno, opstr);
+            goto done;
+        }
+        if (touched && mt && mod_touch_verify(mt) < 0)
+            goto done;
+        gettimeofday(&t1, NULL);
+        timersub(&t1, &t0, &td);
+        if (mod_stat_add(&ms[opx], (uint64_t)td.tv_sec*1000000 + td.tv_usec) < 0)
+            goto done;
+    }
+    for (i=0; i<sizeof(ms)/sizeof(*ms); i++)
+        mod_stat_print(stderr, &ms[i]);
+    retval = 0;
+ done:
+    for (i=0; i<sizeof(ms)/sizeof(*ms); i++)
+        if (ms[i].ms_vec)
+            free(ms[i].ms_vec);
+    if (line)
+        free(line);
+    if (f)
+        fclose(f);
+    return retval;
+}
+
+/*! Apply an edit script, or one operation, on a base tree
+ *
+ * @param[out] xbp  Base subtree modified: base tree for an edit script
+ */
+static int
+mod_run(clixon_handle     h,
+        yang_stmt        *yspec,
+        cxobj            *x0,
+        char             *script,
+        int               touched,
+        enum opx          opx,
+        char             *xpath,
+        char             *x1str,
+        struct mod_touch *mt,
+        cxobj           **xbp)
+{
+    if (script == NULL)
+        return mod_apply(h, yspec, x0, opx, xpath, x1str, mt, 0, xbp);
+    *xbp = x0;
+    return mod_script(h, yspec, x0, script, touched, mt);
+}
+
 static int
 usage(char *argv0)
 {
@@ -102,7 +589,12 @@ usage(char *argv0)
             "\t-b <base> \tXML base expression\n"
             "\t-x <xml>  \tXML to insert\n"
             "\t-p <xpath>\tXpath to where in base and XML\n"
-            "\t-s        \tSort output after operation\n",
+            "\t-s        \tSort output after operation, or once after edit script\n"
+            "\t-f <file> \tXML base file, instead of -b\n"
+            "\t-e <file> \tEdit script, one operation per line: <op>TAB<xpath>TAB<xml>\n"
+            "\t-t        \tSort modified parent and new subtrees after each operation of edit script\n"
+            "\t-I        \tKeep YANG order incrementally, verify modified parents only\n"
+            "\t-C        \tCompare time of -I with operation and full sort\n",
             argv0
             );
     exit(0);
@@ -121,18 +613,27 @@ main(int argc, char **argv)
     char         *xpath = NULL;
     yang_stmt    *yspec = NULL;
     cxobj        *x0 = NULL;
-    cxobj        *x1 = NULL;
     cxobj        *xb = NULL;
-    cxobj        *xi = NULL;
-    cxobj        *xi1 = NULL;
     cxobj        *xerr = NULL;
     int           sort = 0;
     int           ret;
     clixon_handle h;
     enum opx      opx = OPX_ERROR;
-    char         *reason = NULL;
     int           dbg = 0;
     cxobj        *xcfg = NULL;
+    char         *basefile = NULL;
+    char         *script = NULL;
+    int           touched = 0;
+    FILE         *fp = NULL;
+    int           incremental = 0;
+    int           compare = 0;
+    struct mod_touch touch = {0,};
+    struct mod_touch *mt = NULL;
+    cxobj        *xc = NULL;
+    cxobj        *xbc = NULL;
+    struct timeval t0;
+    struct timeval t1;
+    struct timeval td;
 
     if ((h = clixon_handle_init()) == NULL)
         goto done;
@@ -174,14 +675,29 @@ main(int argc, char **argv)
         case 's': /* sort output after insert */
             sort++;
             break;
+        case 'f': /* Base XML file */
+            basefile = optarg;
+            break;
+        case 'e': /* Edit script */
+            script = optarg;
+            break;
+        case 't': /* Sort modified subtree after each edit */
+            touched++;
+            break;
+        case 'I': /* Incremental sort */
+            incremental++;
+            break;
+        case 'C': /* Compare incremental and full sort */
+            compare++;
+            break;
         default:
             usage(argv[0]);
             break;
         }
     /* Sanity check: check mandatory arguments */
-    if (x1str == NULL || x0str == NULL || yangfile == NULL)
+    if ((x0str == NULL && basefile == NULL) || yangfile == NULL)
         usage(argv0);
-    if (opx == OPX_ERROR)
+    if (script == NULL && (x1str == NULL || opx == OPX_ERROR))
         usage(argv0);
     clixon_debug_init(h, dbg);
     if (yang_init(h) < 0)
@@ -191,7 +707,15 @@ main(int argc, char **argv)
     if (yang_spec_parse_file(h, yangfile, yspec) < 0)
         goto done;
     /* Parse base XML */
-    if ((ret = clixon_xml_parse_string(x0str, YB_MODULE, yspec, &x0, &xerr)) < 0){
+    if (basefile){
+        if ((fp = fopen(basefile, "r")) == NULL){
+            clixon_err(OE_UNIX, errno, "fopen(%s)", basefile);
+            goto done;
+        }
+        if ((ret = clixon_xml_parse_file(fp, YB_MODULE, yspec, &x0, &xerr)) < 0)
+            goto done;
+    }
+    else if ((ret = clixon_xml_parse_string(x0str, YB_MODULE, yspec, &x0, &xerr)) < 0){
         clixon_err(OE_XML, 0, "Parsing base xml: %s", x0str);
         goto done;
     }
@@ -199,84 +723,44 @@ main(int argc, char **argv)
         clixon_err_netconf(h, OE_XML, 0, xerr, "Parsing base xml");
         goto done;
     }
-    /* Get base subtree by xpath */
-    if (xpath == NULL)
-        xb = x0;
-    else if ((xb = xpath_first(x0, NULL, "%s", xpath)) == NULL){
-        clixon_err(OE_XML, 0, "xpath: %s not found in x0", xpath);
+    /* Incremental operations search and insert in place, sort the base once */
+    if ((incremental || compare) && xml_sort_recurse(x0) < 0)
         goto done;
-    }
-    if (clixon_debug_get()){
-        clixon_debug(CLIXON_DBG_DEFAULT, "xb:");
-        xml_print(stderr, xb);
-    }
-    switch (opx){
-    case OPX_PARENT:
-        /* Parse insert XML */
-        if ((ret = clixon_xml_parse_string(x1str, YB_PARENT, yspec, &xb, &xerr)) < 0){
-            clixon_err(OE_XML, 0, "Parsing insert xml: %s", x1str);
-            goto done;
-        }
-        if (ret == 0){
-            clixon_err_netconf(h, OE_XML, 0, xerr, "Parsing secondary xml");
+    if (compare){
+        /* Operation and full sort on a copy */
+        if ((xc = xml_dup(x0)) == NULL)
             goto done;
-        }
-        break;
-    case OPX_MERGE:
-        /* Parse merge XML */
-        if ((ret = clixon_xml_parse_string(x1str, YB_MODULE, yspec, &x1, &xerr)) < 0){
-            clixon_err(OE_XML, 0, "Parsing insert xml: %s", x1str);
-            goto done;
-        }
-        if (ret == 0){
-            clixon_err_netconf(h, OE_XML, 0, xerr, "Parsing secondary xml");
-            goto done;
-        }
-        if (xpath == NULL)
-            xi = x1;
-        else if ((xi = xpath_first(x1, NULL, "%s", xpath)) == NULL){
-            clixon_err(OE_XML, 0, "xpath: %s not found in xi", xpath);
-            goto done;
-        }
-        if ((ret = xml_merge(xb, xi, yspec, &reason)) < 0)
-            goto done;
-        if (ret == 0){
-            clixon_err(OE_XML, 0, "%s", reason);
-            goto done;
-        }
-        break;
-    case OPX_INSERT:
-        /* Parse insert XML */
-        if ((ret = clixon_xml_parse_string(x1str, YB_MODULE, yspec, &x1, &xerr)) < 0){
-            clixon_err(OE_XML, 0, "Parsing insert xml: %s", x1str);
+        gettimeofday(&t0, NULL);
+        if (mod_run(h, yspec, xc, script, touched, opx, xpath, x1str, NULL, &xbc) < 0)
             goto done;
-        }
-        if (ret == 0){
-            clixon_err_netconf(h, OE_XML, 0, xerr, "Parsing secondary xml");
-            goto done;
-        }
-        /* Get secondary subtree by xpath */
-        if (xpath == NULL)
-            xi = x1;
-        else if ((xi = xpath_first(x1, NULL, "%s", xpath)) == NULL){
-            clixon_err(OE_XML, 0, "xpath: %s not found in xi", xpath);
-            goto done;
-        }
-
-        /* Find first element child of secondary */
-        if ((xi1 = xml_child_i_type(xi, 0, CX_ELMNT)) == NULL){
-            clixon_err(OE_XML, 0, "xi has no element child");
-            goto done;
-        }
-        /* Remove it from parent */
-        if (xml_rm(xi1) < 0)
-            goto done;
-        if (xml_insert(xb, xi1, INS_LAST, NULL, NULL) < 0)
+        xml_sort_recurse(xbc);
+        gettimeofday(&t1, NULL);
+        timersub(&t1, &t0, &td);
+        fprintf(stderr, "full sort: %lu.%06lu\n", td.tv_sec, td.tv_usec);
+    }
+    if (incremental || compare)
+        mt = &touch;
+    gettimeofday(&t0, NULL);
+    if (mod_run(h, yspec, x0, script, touched, opx, xpath, x1str, mt, &xb) < 0)
+        goto done;
+    if (mt){
+        if (mod_touch_verify(mt) < 0)
             goto done;
-        break;
-    default:
-        usage(argv0);
+        sort = 0;
+    }
+    else if (script && sort){
+        xml_sort_recurse(xb);
+        sort = 0;
     }
+    gettimeofday(&t1, NULL);
+    timersub(&t1, &t0, &td);
+    if (compare)
+        fprintf(stderr, "incremental: %lu.%06lu resorted: %d %s\n",
+                td.tv_sec, td.tv_usec, touch.mt_resorted,
+                xml_tree_equal(xc, x0) == 0 ? "equal" : "differ");
+    else if (script)
+        fprintf(stderr, "%s: %lu.%06lu\n",
+                mt ? "incremental" : "script", td.tv_sec, td.tv_usec);
     if (clixon_debug_get()){
         clixon_debug(CLIXON_DBG_DEFAULT, "x0:");
         xml_print(stderr, x0);
@@ -297,14 +781,16 @@ main(int argc, char **argv)
     yang_exit(h);
     if (x0)
         xml_free(x0);
-    if (x1)
-        xml_free(x1);
+    if (xc)
+        xml_free(xc);
+    if (touch.mt_vec)
+        free(touch.mt_vec);
     if (xcfg)
         xml_free(xcfg);
     if (xerr)
         xml_free(xerr);
-    if (reason)
-        free(reason);
+    if (fp)
+        fclose(fp);
     if (fd > 0)
         close(fd);
     return retval;